@@ -13,53 +13,40 @@ static ivec2 pxMousePos(void)
     return m;
 }
 
-void pxPlotLineSmooth2(const Tex2D texture, vec2 p, vec2 q, const Px color)
-{
-    int x, y;
-    for (y = -1; y <= 1; ++y) {
-        for (x = -1; x <= 1; ++x) {
-            vec2 P, Q;
-            P.x = p.x + (float)x;
-            P.y = p.y + (float)y;
-            Q.x = q.x + (float)x;
-            Q.y = q.y + (float)y;
-            pxPlotLineSmooth(texture, P, Q, color);
-        }
-    }
-}
+#define BEZIER_POINTS 256
 
-void pxPlotBezier2Smooth2(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
+void pxPlotBezier2Wide(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
 {
+    int count = 1;
     float t;
-    vec2 P[2];
+    vec2 P[BEZIER_POINTS];
     const float dx = SPXM_ABS(b.x - a.x), dy = SPXM_ABS(b.y - a.y);
     const float dxy = SPXM_MAX(dx, dy);
-    const float delta = dxy != 0.0F ? 4.0F / dxy : 1.0F;
+    const float delta = dxy > 4.0F * (BEZIER_POINTS - 2) ? 1.0F / (BEZIER_POINTS - 2) :
+        dxy != 0.0F ? 4.0F / dxy : 1.0F;
 
     P[0] = a;
 
-    for (t = delta; t < 1.0; t += delta) {
+    for (t = delta; t < 1.0 && count < BEZIER_POINTS - 1; t += delta) {
         vec2 p1, p2;
         p1 = vec2_lerp(a, c, t);
         p2 = vec2_lerp(c, b, t);
-        P[1] = vec2_lerp(p1, p2, t);
-        pxPlotLineSmooth2(texture, P[0], P[1], col);
-        P[0] = P[1];
+        P[count++] = vec2_lerp(p1, p2, t);
     }
     
-    P[1] = b;
-    pxPlotLineSmooth2(texture, P[0], P[1], col);
+    P[count++] = b;
+    pxPlotPolyline(texture, P, count, 3.0F, SPXP_JOIN_ROUND, col);
 }
 
 int main(const int argc, const char** argv)
 {
     const Px red = {255, 0, 0, 255}, green = {0, 255, 0, 255};
     const Px blue = {0, 0, 255, 255}, purple = {255, 0, 255, 255};
+    const Px black = {0, 0, 0, 0};
     
     ivec2 m, p, q = {0, 0};
     vec2 c, mf;
     Tex2D fb;
-    size_t size;
 
     int w = WIDTH, h = HEIGHT, s = 0, t = 1, i;
     for (i = 1; i < argc; ++i) {
@@ -105,7 +92,7 @@ int main(const int argc, const char** argv)
     p.y = fb.height / 2;
     c.x = (float)spxe.scrres.width * 0.5F;
     c.y = (float)spxe.scrres.height * 0.5F;
-    size = spxe.scrres.width * spxe.scrres.height * 4;
+    spxxDirtyTracking(1);
     
     while (spxeRun(fb.pixbuf)) {
         
@@ -117,7 +104,7 @@ int main(const int argc, const char** argv)
         }
         
         m = pxMousePos();
-        memset(fb.pixbuf, 0, size);
+        spxeDirtyClear(fb.pixbuf, black);
         pxPlotRect(fb, p, m, purple);
         
         if (t) {
@@ -135,8 +122,8 @@ int main(const int argc, const char** argv)
         mf = vec2_from_ivec2(m);
         pxPlotLineSmooth(fb, c, mf, green);
         pxPlotCircleSmooth(fb, m, 20.0F, blue);
-        pxPlotBezier2Smooth2(fb, c, vec2_from_ivec2(q), mf, green);
-        pxPlotLineSmooth2(fb, c, mf, blue);
+        pxPlotBezier2Wide(fb, c, vec2_from_ivec2(q), mf, green);
+        pxPlotLineWide(fb, c, mf, 3.0F, blue);
     }
 
     return spxxEnd(fb);
@@ -78,6 +78,9 @@ include statement.
 #define spxxEnd(tex) spxeEnd((tex).pixbuf)
 #define spxxStart(title, ww, wh, sw, sh) (Tex2D){spxeStart(title, ww, wh, sw, sh), sw, sh}
 
+void spxxDirty(const Tex2D texture, int x, int y, int width, int height);
+void spxxDirtyTracking(const int enable);
+
 #ifdef SPXX_APPLICATION
 
 /*********************
@@ -87,6 +90,23 @@ Simple PiXel Extension
 *  IMPLEMENTATION    *
 *********************/
 
+/* forward spxplot dirty regions of the screen sized framebuffer to spxe */
+
+void spxxDirty(const Tex2D texture, int x, int y, int width, int height)
+{
+    int w, h;
+    spxeScreenSize(&w, &h);
+    if (texture.width == w && texture.height == h) {
+        spxeDirtyRect(x, y, width, height);
+    }
+}
+
+void spxxDirtyTracking(const int enable)
+{
+    spxeDirtyTracking(enable);
+    pxDirtyCallback(enable ? spxxDirty : NULL);
+}
+
 #endif /* SPXX_APPLICATION */
 #endif /* SIMPLE_PIXEL_EXTENSION_H */
 
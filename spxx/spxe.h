@@ -55,6 +55,362 @@ On Windows and Linux you also need GLEW.
 MacOS:      -framework OpenGL -lglfw
 Linux:      -lGL -lGLEW -lglfw
 Windows:    -lopengl32 -lglfw3dll -lglew32
+Headless:   -DSPXE_HEADLESS (no external dependencies)
+Threaded:   -DSPXE_THREADED -lpthread
+Capture:    -DSPXE_CAPTURE -lpthread
+Shared:     -DSPXE_SHARED (-lrt on older glibc)
+
+****************** Headless Mode *******************
+
+Defining SPXE_HEADLESS before including spxe.h compiles
+spxe without GLFW or OpenGL. spxeStart only allocates the
+pixel framebuffer, spxeRun hands every frame to the sink
+set with spxeFrameSink and advances a virtual clock of
+SPXE_HEADLESS_FPS frames per second read by spxeTime.
+Rendering runs at full CPU speed without a display server.
+Returning 0 from the sink makes spxeRun return 0. Phase
+timing needs clock_gettime on POSIX targets, see Timing
+Statistics.
+
+****************** Upload Modes ********************
+
+spxeUploadMode selects how spxeRender copies the pixel
+framebuffer into the screen texture:
+
+SPXE_UPLOAD_DIRECT:     glTexSubImage2D straight from
+                        the pixel framebuffer (default)
+SPXE_UPLOAD_PBO:        copy into a ring of SPXE_PBO_COUNT
+                        mapped pixel unpack buffers so the
+                        driver transfer overlaps with the
+                        next frame
+SPXE_UPLOAD_PERSISTENT: same ring, persistently mapped and
+                        guarded with fences (ARB_buffer_storage)
+
+When a mode is not supported by the context spxeUploadMode
+falls back to the closest supported one and returns it.
+
+***************** Pixel Formats ********************
+
+spxePixelFormat, called before spxeStart, selects a more
+compact framebuffer that is uploaded as is and expanded
+to color by the GPU, cutting upload bandwidth and cache
+footprint by 2 to 4 times:
+
+SPXE_FORMAT_RGBA:       4 byte Px (default)
+SPXE_FORMAT_INDEXED:    1 byte index into a palette of
+                        256 Px set with spxePalette,
+                        a gray ramp until it is set
+SPXE_FORMAT_GRAY:       1 byte luminance
+SPXE_FORMAT_RGB565:     2 byte 5-6-5 packed color
+
+spxeStart still returns a Px pointer, which has to be cast
+to unsigned char or unsigned short for compact formats, and
+frame sinks receive the framebuffer in its format. The 
+framebuffer keeps being addressed by pixel index with
+width * height pixels. spxeDirtyClear converts its color
+to the framebuffer format, taking the palette index from
+the red channel for indexed framebuffers, and captured
+frames are always expanded to RGBA.
+
+***************** Supersampling ********************
+
+spxeSupersample, called before spxeStart with a factor of
+2 or 4, makes spxeStart hand out a framebuffer factor times
+wider and taller than the screen. Aliased primitives drawn
+into it are averaged over factor x factor samples by
+spxeRender, with SSE2 or NEON where available, giving every
+primitive the same anti-aliasing. spxeScreenSize,
+spxeMousePos, cursor events and spxeDirtyRect work at the
+sample resolution, while frame sinks, capture, screenshots,
+shared memory and late latching see the downsampled frame.
+Only RGBA and gray framebuffers are supersampled, and the
+resolution does not change dynamically while supersampling.
+
+    spxeSupersample(2);
+    Px* pixbuf = spxeStart("AA", 800, 600, 400, 300);
+    spxeScreenSize(&width, &height);    800 x 600 samples
+
+**************** Dirty Rectangles ******************
+
+With spxeDirtyTracking enabled spxeRender only uploads the
+regions marked with spxeDirtyRect since the last frame.
+Overlapping regions are merged, and when more than 
+SPXE_DIRTY_MAX regions are marked they collapse into their
+bounding box. spxeDirtyClear clears the regions that were
+dirty in the previous frame and marks them dirty again,
+replacing a full memset of the framebuffer every frame.
+With tracking disabled spxeDirtyClear clears everything.
+
+***************** Threaded Mode ********************
+
+Defining SPXE_THREADED moves texture upload, drawing and
+buffer swaps to a background thread that owns the OpenGL
+context, so the application never blocks on vsync. spxeStart
+hands out one of a ring of three pixel framebuffers and
+spxePresent exchanges the finished one for a free one:
+
+    Px* pixbuf = spxeStart("Threaded", 800, 600, 400, 300);
+    while (spxePresent(&pixbuf)) {
+        draw into pixbuf
+    }
+    return spxeEnd(pixbuf);
+
+The render thread always presents the most recently
+completed framebuffer. A new framebuffer holds an older
+frame, so it has to be redrawn entirely, and dirty tracking
+is not available. spxeRun keeps working by copying its
+framebuffer into the ring. Without SPXE_THREADED spxePresent
+behaves like spxeRun. SPXE_THREADED is ignored by headless
+builds.
+
+****************** Frame Pacing ********************
+
+spxeSwapInterval selects SPXE_VSYNC_ON (default), 
+SPXE_VSYNC_OFF or SPXE_VSYNC_ADAPTIVE, which falls back to
+vsync when the swap control tear extension is missing.
+spxeFrameLimit caps an uncapped loop at a frame rate by
+sleeping in spxeStep, 0 removes the cap.
+
+spxeFixedUpdate registers a callback that spxeStep calls
+at a fixed rate, as many times as the elapsed time requires
+but at most maxsteps per frame. Rendering can then use
+spxeFixedAlpha, the fraction of a step left unsimulated,
+to interpolate between the last two simulated states:
+
+    spxeFixedUpdate(update, &world, 120.0, 8);
+    while (spxeRun(pixbuf)) {
+        draw(&world, spxeFixedAlpha());
+    }
+
+**************** On Demand Redraw ******************
+
+spxeRedrawOnDemand turns spxeRun into an event driven loop
+for mostly static content. spxeRender only uploads and
+draws the framebuffer when spxeRedraw was called, dirty
+regions were marked, or an input, resize or window refresh
+event arrived since the last presented frame, and spxeStep
+swaps only presented frames and then sleeps in
+glfwWaitEvents until the next event, spxeRedraw from any
+thread or the timeout in seconds, 0 waiting forever:
+
+    spxeRedrawOnDemand(1, 0.5);
+    while (spxeRun(pixbuf)) {
+        if (update(pixbuf)) {
+            spxeRedraw();
+        }
+    }
+
+The frame limit is not used while waiting for events and
+idle time is not counted by the timing statistics. On
+demand redraw is ignored by headless builds.
+
+*************** Dynamic Resolution *****************
+
+spxeDynamicScale adapts the screen resolution to keep the
+time the application spends drawing each frame, from the
+return of spxePresent to its next call, within the budget
+of a target frame rate. After SPXE_SCALE_COOLDOWN frames
+over 90% of the budget the screen width shrinks by 10%, and
+under 60% it grows by 10%, between minwidth and maxwidth and
+keeping the aspect ratio of spxeStart. The framebuffer is
+reallocated and handed back by spxePresent, so it must be
+used instead of spxeRun, and the new framebuffer has to be
+drawn entirely. spxeScreenSize and spxeMousePos follow the
+new resolution. Resolution does not change while capturing.
+
+    spxeDynamicScale(60.0, 160, 640);
+    while (spxePresent(&pixbuf)) {
+        spxeScreenSize(&width, &height);
+        ...
+    }
+
+*************** Timing Statistics ******************
+
+spxeStatsRecord starts timing every phase of spxeRender and
+spxeStep (upload, draw, sink, event polling and buffer
+swap) into a ring of the last SPXE_STATS_FRAMES frames.
+spxeStatsQuery summarizes the ring into frame time
+percentiles, mean phase times, upload bandwidth and the
+number of dropped frames, those taking longer than 1.5
+times the frame limit period or the median frame time.
+spxeStatsDump names a file written at spxeEnd with every
+recorded frame, as JSON when it ends in .json and as CSV
+otherwise. Headless builds time phases with a monotonic
+wall clock, clock_gettime on POSIX, which needs
+_POSIX_C_SOURCE 200112L defined before any #include when
+spxe.h is not the first header under a strict ISO mode. The
+threaded render thread does not time event polling.
+
+****************** Input Latency *******************
+
+Every presented frame is stamped with the time of the newest
+input event received before the frame started drawing, and
+the time from that event to the end of the buffer swap that
+shows the frame is recorded with the timing statistics.
+Frames without new input record no latency. spxeStatsQuery
+returns its percentiles as latency50, latency95 and
+latency99, measured from the moment GLFW delivers an event.
+
+spxeLateLatch installs a function called right before each
+upload with the framebuffer and the cursor position sampled
+again at that moment, to draw cursor-like overlays with less
+latency than the rest of the frame:
+
+    static void cursor(Px* pixbuf, int x, int y, void* data)
+    {
+        if (x >= 0 && y >= 0 && x < width && y < height)
+            pixbuf[y * width + x] = white;
+    }
+    spxeLateLatch(cursor, NULL);
+
+The overlay stays in the framebuffer, so the area under it
+must be redrawn every frame, and marked with spxeDirtyRect
+when dirty tracking is enabled. Threaded builds latch the
+last cursor position delivered by GLFW instead, as only the
+main thread may query it. Headless builds never latch.
+
+****************** Input Events ********************
+
+The GLFW callbacks record every key, character, mouse
+button, cursor and window resize event with its timestamp
+into a lock-free ring of SPXE_EVENT_QUEUE events, read in
+order with spxeEventPoll after spxeRun or spxeStep:
+
+    spxeEvent e;
+    while (spxeEventPoll(&e)) {
+        if (e.type == SPXE_EVENT_KEY && e.action == GLFW_PRESS)
+            ...
+    }
+
+Events arriving while the ring is full are discarded, the
+older ones are kept. Cursor events hold screen coordinates
+and resize events the new window size. spxeKeyChar returns
+the queued characters one by one instead of only the last
+one. Mouse state is captured once per frame by spxeStep, so
+the spxeMouse queries never call into GLFW.
+
+******************* Screenshots ********************
+
+spxeScreenshot requests a copy of the next presented frame,
+as the window shows it, without stalling the pipeline. The
+window is read into one of SPXE_SHOT_BUFFERS pixel pack
+buffers after drawing and the copy is delivered as an RGBA
+Img2D, top row first, to the callback a frame or two later,
+once the GPU has finished it. The callback owns the image
+and frees it with spxImageFree or free on its pixbuf, which
+is NULL when the copy failed. It runs on the thread that
+renders, like frame sinks. spxeScreenshot returns 0 while
+a previous request has not been read yet, and always in
+headless builds, where frame sinks see every frame.
+
+    static void thumbnail(Img2D image, void* data)
+    {
+        spxImageSave(image, "thumbnail.png");
+        spxImageFree(&image);
+    }
+    spxeScreenshot(thumbnail, NULL);
+
+***************** Input Recording ******************
+
+spxeRecordStart writes every input event and the spxeTime
+and mouse position of every frame to a binary file, and
+spxeReplayStart feeds a recording back through the same
+spxeKey, spxeMouse, spxeEventPoll and spxeTime queries,
+ignoring live input, so an interactive session can be run
+again frame by frame for benchmarks. Both start after
+spxeStart and stop with spxeRecordStop or spxeEnd, and
+spxeRun returns 0 once a replay runs out of frames:
+
+    spxeReplayStart("session.spxr");
+    while (spxeRun(pixbuf)) {
+        ...
+    }
+
+While recording or replaying, spxeTime holds the time the
+current frame started and fixed updates step through the
+same times. Recordings are fixed size records in host byte
+order and replay in headless builds as well.
+
+****************** Frame Capture *******************
+
+Defining SPXE_CAPTURE enables spxeCaptureStart, which
+streams every presented frame into a file descriptor, such
+as a pipe into a video encoder, until spxeCaptureStop or 
+spxeEnd. Frames are copied into a ring of 
+SPXE_CAPTURE_BUFFERS buffers allocated once and written
+by a background thread, top row first, either as raw RGBA
+without any header (SPXE_CAPTURE_RAW) or as a YUV4MPEG2
+stream in full range 4:2:0 (SPXE_CAPTURE_Y4M):
+
+    spxeCaptureStart(fd, SPXE_CAPTURE_Y4M, 60.0);
+
+ffmpeg reads raw frames with -f rawvideo -pix_fmt rgba
+-s WxH -i -. When the writer falls behind presenting 
+blocks until a buffer is free, so no frame is lost. The
+file descriptor is not closed by spxe.
+
+***************** Shared Framebuffer ****************
+
+Defining SPXE_SHARED enables spxeShare, which has to be
+called before spxeStart to place the framebuffers in a POSIX
+shared memory segment that other processes can map and read
+without copies. The segment starts with an spxeShared header
+followed by a ring of SPXE_SHARED_BUFFERS framebuffers of
+the framebuffer format. Each framebuffer has a sequence
+number that is odd while spxe writes it, forming a seqlock,
+and the frame number it holds. spxePresent publishes the
+framebuffer it was given and hands out the next one of the
+ring, spxeRun copies into a free one. A reader takes the
+last published framebuffer and retries while it changed:
+
+    do {
+        i = shared->latest;
+        seq = shared->sequence[i];
+        read framebuffer i
+    } while ((seq & 1) || shared->sequence[i] != seq);
+
+Threaded builds keep their render ring in the segment.
+Resolution does not change while sharing, and spxeEnd
+unlinks the segment.
+
+shm_open and ftruncate are POSIX.1-2001. spxe defines
+_POSIX_C_SOURCE itself when it is the first header, under a
+strict ISO mode like -std=c99 any other header included
+first hides them, so define _POSIX_C_SOURCE 200112L before
+every #include or compile with -D_POSIX_C_SOURCE=200112L.
+spxe stops with an #error otherwise.
+
+******************** Contexts **********************
+
+All engine state lives in a context. Every thread starts
+on the default context, so single window programs never
+see one. spxeCreate allocates a new context and
+spxeMakeCurrent selects the context used by the calling
+thread from then on, returning the previous one. A NULL
+context selects the default. Independent contexts can run
+in parallel threads, which is mostly useful for headless
+builds as GLFW windows must be handled by the main thread:
+
+    spxeContext* ctx = spxeCreate();
+    spxeMakeCurrent(ctx);
+    Px* pixbuf = spxeStart("Job", 800, 600, 400, 300);
+    while (spxeRun(pixbuf)) {
+        ...
+    }
+    spxeEnd(pixbuf);
+    spxeDestroy(ctx);
+
+Windows route their input to the context that opened them.
+spxeEnd closes the window of the current context and
+terminates GLFW after the last one. Windows are opened
+and closed from the main thread only. spxeDestroy also
+ends a context that is still running, releasing its
+window, threads and shared memory, but only spxeEnd can
+free the framebuffer spxeStart returned.
+
+The current context is thread local. Compilers without a
+known thread local keyword stop with an error, defining
+SPXE_THREAD_LOCAL as empty accepts a single thread.
 
 *************** Hello World Example ****************
 
@@ -85,9 +441,103 @@ typedef struct Px {
 
 #endif /* PX_TYPE_DEFINED */
 
+#ifndef IMG2D_TYPE_DEFINED
+#define IMG2D_TYPE_DEFINED
+
+typedef struct Img2D {
+    unsigned char* pixbuf;
+    int width;
+    int height;
+    int channels;
+} Img2D;
+
+#endif /* IMG2D_TYPE_DEFINED */
+
+typedef struct spxeInfo spxeContext;
+typedef int (*spxeSinkFunc)(const Px* pixbuf, int width, int height, void* data);
+typedef void (*spxeUpdateFunc)(double dt, void* data);
+typedef void (*spxeLatchFunc)(Px* pixbuf, int x, int y, void* data);
+typedef void (*spxeShotFunc)(Img2D image, void* data);
+
+typedef struct spxeEvent {
+    int type;
+    int code;
+    int action;
+    int mods;
+    int x, y;
+    double time;
+} spxeEvent;
+
+typedef struct spxeStats {
+    long frames;
+    long dropped;
+    double p50, p95, p99;
+    double upload, draw, sink, poll, swap;
+    double bandwidth;
+    double latency50, latency95, latency99;
+} spxeStats;
+
+
+/* texture upload modes */
+
+#define SPXE_UPLOAD_DIRECT      0
+#define SPXE_UPLOAD_PBO         1
+#define SPXE_UPLOAD_PERSISTENT  2
+
+/* input event types */
+
+#define SPXE_EVENT_KEY          1
+#define SPXE_EVENT_CHAR         2
+#define SPXE_EVENT_MOUSE        3
+#define SPXE_EVENT_CURSOR       4
+#define SPXE_EVENT_RESIZE       5
+
+/* shared framebuffer export */
+
+#define SPXE_SHARED_BUFFERS     3
+
+typedef struct spxeShared {
+    char magic[4];
+    int version;
+    int width, height;
+    int format;
+    int pixelsize;
+    int count;
+    int offset;
+    long stride;
+    long latest;
+    long frame;
+    long sequence[SPXE_SHARED_BUFFERS];
+    long frames[SPXE_SHARED_BUFFERS];
+} spxeShared;
+
+/* frame capture formats */
+
+#define SPXE_CAPTURE_RAW        0
+#define SPXE_CAPTURE_Y4M        1
+
+/* framebuffer pixel formats */
+
+#define SPXE_FORMAT_RGBA        0
+#define SPXE_FORMAT_INDEXED     1
+#define SPXE_FORMAT_GRAY        2
+#define SPXE_FORMAT_RGB565      3
+
+/* swap intervals */
+
+#define SPXE_VSYNC_ADAPTIVE     (-1)
+#define SPXE_VSYNC_OFF          0
+#define SPXE_VSYNC_ON           1
+
+/* contexts */
+spxeContext* spxeCreate(    void                                            );
+void    spxeDestroy(        spxeContext* context                            );
+spxeContext* spxeMakeCurrent(spxeContext* context                           );
+
 /* spxe core */
 int     spxeStep(           void                                            );
 int     spxeRun(            const Px*   pixbuf                              );
+int     spxePresent(        Px**        pixbuf                              );
 void    spxeRender(         const Px*   pixbuf                              );
 int     spxeEnd(            Px*         pixbuf                              );
 Px*     spxeStart(          const char* title,
@@ -97,10 +547,64 @@ Px*     spxeStart(          const char* title,
 void    spxeScreenSize(     int*        widthptr,   int*        heightptr   );
 void    spxeWindowSize(     int*        widthptr,   int*        heightptr   );
 void    spxeBackgroundColor(const Px    px                                  );
+void    spxeFrameSink(      spxeSinkFunc sink,      void*       data        );
+long    spxeFrameCount(     void                                            );
+int     spxeUploadMode(     const int   mode                                );
+int     spxePixelFormat(    const int   format                              );
+int     spxeSupersample(    const int   factor                              );
+void    spxePalette(        const Px*   colors,     const int   count       );
+
+/* dirty rectangles */
+void    spxeDirtyTracking(  const int   enable                              );
+void    spxeDirtyRect(      const int   x,          const int   y,
+                            const int   width,      const int   height      );
+void    spxeDirtyClear(     Px*         pixbuf,     const Px    px          );
 
 /* time input */
 double  spxeTime(           void                                            );
 
+/* on demand redraw */
+void    spxeRedrawOnDemand( const int   enable,     const double timeout    );
+void    spxeRedraw(         void                                            );
+
+/* dynamic resolution */
+void    spxeDynamicScale(   const double fps,       const int   minwidth,
+                            const int   maxwidth                            );
+
+/* frame pacing */
+void    spxeSwapInterval(   const int   interval                            );
+void    spxeFrameLimit(     const double fps                                );
+void    spxeFixedUpdate(    spxeUpdateFunc update,  void*       data,
+                            const double rate,      const int   maxsteps    );
+double  spxeFixedAlpha(     void                                            );
+
+/* frame capture */
+int     spxeCaptureStart(   const int   fd,         const int   format,
+                            const double fps                                );
+void    spxeCaptureStop(    void                                            );
+
+/* shared framebuffer export */
+int     spxeShare(          const char* name                                );
+
+/* screenshots */
+int     spxeScreenshot(     spxeShotFunc shot,      void*       data        );
+
+/* input recording */
+int     spxeRecordStart(    const char* path                                );
+int     spxeReplayStart(    const char* path                                );
+void    spxeRecordStop(     void                                            );
+
+/* input latency */
+void    spxeLateLatch(      spxeLatchFunc latch,    void*       data        );
+
+/* timing statistics */
+void    spxeStatsRecord(    const int   enable                              );
+void    spxeStatsDump(      const char* path                                );
+spxeStats spxeStatsQuery(   void                                            );
+
+/* input events */
+int     spxeEventPoll(      spxeEvent*  event                               );
+
 /* keyboard input */
 int     spxeKeyDown(        const int   key                                 );
 int     spxeKeyPressed(     const int   key                                 );
@@ -260,10 +764,91 @@ Simple PiXel Engine
 
 #ifdef SPXE_APPLICATION
 
+/* shm_open, ftruncate and clock_gettime are POSIX, hidden by strict ISO C modes */
+#if (defined(SPXE_SHARED) || defined(SPXE_HEADLESS)) && !defined(_WIN32) &&\
+    !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+    #define _POSIX_C_SOURCE 200112L
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SPXE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define SPXE_NEON
+#endif
+
+#ifndef SPXE_PBO_COUNT
+    #define SPXE_PBO_COUNT 3
+#endif
+
+#ifndef SPXE_DIRTY_MAX
+    #define SPXE_DIRTY_MAX 32
+#endif
+
+#ifndef SPXE_STATS_FRAMES
+    #define SPXE_STATS_FRAMES 512
+#endif
+
+#ifndef SPXE_EVENT_QUEUE
+    #define SPXE_EVENT_QUEUE 256
+#endif
+
+#ifndef SPXE_SCALE_COOLDOWN
+    #define SPXE_SCALE_COOLDOWN 30
+#endif
+
+#ifndef SPXE_CHAR_QUEUE
+    #define SPXE_CHAR_QUEUE 32
+#endif
+
+#ifndef SPXE_SHOT_BUFFERS
+    #define SPXE_SHOT_BUFFERS 2
+#endif
+
+#define SPXE_RECORD_OFF     0
+#define SPXE_RECORD_WRITE   1
+#define SPXE_RECORD_REPLAY  2
+#define SPXE_RECORD_SIZE    24
+
+/* single producer single consumer ring indices */
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define spxeAtomicLoad(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+    #define spxeAtomicStore(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#else
+    #define spxeAtomicLoad(ptr) (*(volatile long*)(ptr))
+    #define spxeAtomicStore(ptr, val) (*(volatile long*)(ptr) = (val))
+#endif
+
+#ifdef SPXE_HEADLESS
+
+#include <time.h>
+#ifdef _WIN32
+    #include <windows.h>
+#elif (defined(__unix__) || defined(__APPLE__)) && !defined(CLOCK_MONOTONIC)
+    #error "spxe: SPXE_HEADLESS times with clock_gettime, define _POSIX_C_SOURCE 200112L before any #include"
+#endif
+
+#undef SPXE_THREADED
+
+#ifndef SPXE_HEADLESS_FPS
+    #define SPXE_HEADLESS_FPS 60
+#endif
+
+#define GLFW_RELEASE 0
+#define GLFW_PRESS 1
+#define GLFW_MOD_SHIFT 0x0001
+#define GLFW_MOD_CAPS_LOCK 0x0010
+
+typedef struct GLFWwindow GLFWwindow;
+
+#else /* SPXE_HEADLESS */
+
 #ifndef __APPLE__
     #include <GL/glew.h>
     #define GLFW_MOD_CAPS_LOCK 0x0010
@@ -274,6 +859,10 @@ Simple PiXel Engine
 
 #include <GLFW/glfw3.h>
 
+#ifdef SPXE_THREADED
+    #include <pthread.h>
+#endif
+
 /* spxe shader strings */
 
 #define _SPXE_TOK2STR(s) #s
@@ -305,17 +894,130 @@ Simple PiXel Engine
 "in vec2 TexCoords;\n"                          \
 "out vec4 FragColor;\n"                         \
 "uniform sampler2D tex;\n"                      \
+"uniform sampler2D palette;\n"                  \
+"uniform int format;\n"                         \
 "void main(void) {\n"                           \
-"    FragColor = texture(tex, TexCoords);\n"    \
+"    vec4 texel = texture(tex, TexCoords);\n"   \
+"    if (format == " SPXE_TOK2STR(SPXE_FORMAT_INDEXED) ") {\n" \
+"        int i = int(texel.r * 255.0 + 0.5);\n" \
+"        texel = texelFetch(palette, ivec2(i, 0), 0);\n"   \
+"    } else if (format == " SPXE_TOK2STR(SPXE_FORMAT_GRAY) ") {\n" \
+"        texel = vec4(texel.rrr, 1.0);\n"       \
+"    }\n"                                       \
+"    FragColor = texel;\n"                      \
 "}\n"
 
 static const char* vertexShader = SPXE_SHADER_HEADER SPXE_SHADER_VERTEX;
 static const char* fragmentShader = SPXE_SHADER_HEADER SPXE_SHADER_FRAGMENT;
 
+#endif /* SPXE_HEADLESS */
+
+#ifdef SPXE_CAPTURE
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #ifndef SPXE_CAPTURE_BUFFERS
+        #define SPXE_CAPTURE_BUFFERS 4
+    #endif
+#endif
+
+#ifdef SPXE_SHARED
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #if !defined(_POSIX_VERSION) || _POSIX_VERSION < 200112L
+        #error "spxe: SPXE_SHARED needs POSIX.1-2001, define _POSIX_C_SOURCE 200112L before any #include"
+    #endif
+#endif
+
 /* spxe core handler */
 
-static struct spxeInfo {
+struct spxeRect {
+    int x0, y0, x1, y1;
+};
+
+struct spxeFrameTimes {
+    double frame;
+    double upload;
+    double draw;
+    double sink;
+    double poll;
+    double swap;
+    double bytes;
+    double latency;
+};
+
+struct spxeShot {
+    unsigned int pbo;
+    void* fence;
+    int width;
+    int height;
+    spxeShotFunc func;
+    void* data;
+};
+
+#ifdef SPXE_THREADED
+
+struct spxeRenderThread {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Px* buffers[3];
+    int draw;
+    int ready;
+    int present;
+    int fresh;
+    int running;
+    int resized;
+    int upload;
+    int colored;
+    Px color;
+    int intervaled;
+    int paletted;
+    int rescaled;
+    int width;
+    int height;
+    double stamps[3];
+    int latchx;
+    int latchy;
+};
+
+#endif /* SPXE_THREADED */
+
+#ifdef SPXE_CAPTURE
+
+struct spxeCapture {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Px* buffers[SPXE_CAPTURE_BUFFERS];
+    unsigned char* scratch;
+    int head;
+    int count;
+    int running;
+    int failed;
+    int fd;
+    int format;
+};
+
+#endif /* SPXE_CAPTURE */
+
+#ifdef SPXE_SHARED
+
+struct spxeSharing {
+    const char* name;
+    spxeShared* header;
+    size_t size;
+    int draw;
+    int presenting;
+};
+
+#endif /* SPXE_SHARED */
+
+struct spxeInfo {
     GLFWwindow* window;
+    int started;
     struct spxeRes {
         int width;
         int height;
@@ -325,183 +1027,2709 @@ static struct spxeInfo {
         float height;
     } ratio;
     struct spxeInput {
-        int mouseState;
-        int queuedChar;
-        int memChar;
-        unsigned char keys[KEY_LAST];
-        unsigned char pressedKeys[KEY_LAST];
+        int mousex;
+        int mousey;
+        double cursorx;
+        double cursory;
+        unsigned char mouse[MOUSE_LAST + 1];
+        unsigned char mouseDown[MOUSE_LAST + 1];
+        unsigned char pressedMouse[MOUSE_LAST + 1];
+        unsigned char keys[KEY_LAST + 1];
+        unsigned char pressedKeys[KEY_LAST + 1];
+        int charHead;
+        int charTail;
+        char chars[SPXE_CHAR_QUEUE];
     } input;
-} spxe = {NULL, {400, 300}, {800, 600}, {1.0, 1.0}, {GLFW_RELEASE, 1, 0, {0}, {0}}};
-
-/* implementation only static functions */
+    struct spxeEventQueue {
+        long head;
+        long tail;
+        spxeEvent queue[SPXE_EVENT_QUEUE];
+    } events;
+    struct spxeSink {
+        spxeSinkFunc func;
+        void* data;
+        int status;
+    } sink;
+    long frame;
+    struct spxePixel {
+        int format;
+        int paletted;
+        Px palette[256];
+    } pixel;
+    struct spxeUpload {
+        int mode;
+        int index;
+        unsigned int texture;
+        unsigned int palette;
+        unsigned int pbo[SPXE_PBO_COUNT];
+        void* map[SPXE_PBO_COUNT];
+        void* fence[SPXE_PBO_COUNT];
+    } upload;
+    struct spxeDirty {
+        int enabled;
+        int count;
+        int prevcount;
+        struct spxeRect rects[SPXE_DIRTY_MAX];
+        struct spxeRect prev[SPXE_DIRTY_MAX];
+    } dirty;
+    struct spxeSchedule {
+        int interval;
+        double period;
+        double deadline;
+        spxeUpdateFunc update;
+        void* data;
+        double step;
+        double last;
+        double accumulator;
+        double alpha;
+        int maxsteps;
+    } schedule;
+    struct spxeScale {
+        double fps;
+        int minwidth;
+        int maxwidth;
+        int basewidth;
+        int baseheight;
+        int cooldown;
+        double work;
+        double returned;
+    } scale;
+    struct spxeRedraw {
+        int ondemand;
+        int presented;
+        double timeout;
+        long pending;
+    } redraw;
+    struct spxeLatency {
+        double input;
+        double consumed;
+        double recorded;
+        spxeLatchFunc latch;
+        void* data;
+    } latency;
+    struct spxeScreenshot {
+        spxeShotFunc func;
+        void* data;
+        struct spxeShot slots[SPXE_SHOT_BUFFERS];
+    } shot;
+    struct spxeRecord {
+        FILE* file;
+        int mode;
+        double time;
+        double event;
+    } record;
+    struct spxeSupersample {
+        int factor;
+        Px* samples;
+        Px* resolved;
+        unsigned short* accum;
+    } super;
+    struct spxeStatsInfo {
+        int enabled;
+        long count;
+        double last;
+        const char* dump;
+        struct spxeFrameTimes current;
+        struct spxeFrameTimes frames[SPXE_STATS_FRAMES];
+    } stats;
+#ifdef SPXE_THREADED
+    struct spxeRenderThread thread;
+#endif
+#ifdef SPXE_CAPTURE
+    struct spxeCapture capture;
+#endif
+#ifdef SPXE_SHARED
+    struct spxeSharing share;
+#endif
+};
 
-static void spxeFrame(void)
-{
-    int i;
+#ifdef SPXE_THREADED
+    #define SPXE_INFO_THREAD , {                                    \
+        0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,     \
+        {NULL, NULL, NULL}, 0, 1, 2, 0, 0, 0, -1,                   \
+        0, {0, 0, 0, 0}, 0, 0, 0, 0, 0, {0.0, 0.0, 0.0}, 0, 0       \
+    }
+#else
+    #define SPXE_INFO_THREAD
+#endif
 
-    float vertices[16] = {
-        1.0f,   1.0f,   1.0f,   1.0f,
-        1.0f,  -1.0f,   1.0f,   0.0f,
-        -1.0f, -1.0f,   0.0f,   0.0f,
-        -1.0f,  1.0f,   0.0f,   1.0f
-    };
+#ifdef SPXE_CAPTURE
+    #define SPXE_INFO_CAPTURE , {                                   \
+        0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,     \
+        {NULL}, NULL, 0, 0, 0, 0, -1, SPXE_CAPTURE_RAW              \
+    }
+#else
+    #define SPXE_INFO_CAPTURE
+#endif
 
-    const float w = (float)spxe.winres.width / (float)spxe.scrres.width;
-    const float h = (float)spxe.winres.height / (float)spxe.scrres.height;
-    
-    spxe.ratio.width = (h < w) ? (h / w) : 1.0f;
-    spxe.ratio.height = (w < h) ? (w / h) : 1.0f;
+#ifdef SPXE_SHARED
+    #define SPXE_INFO_SHARE , {NULL, NULL, 0, 0, 0}
+#else
+    #define SPXE_INFO_SHARE
+#endif
 
-    for (i = 0; i < 16; i += 4) {
-        vertices[i] *= spxe.ratio.width;
-        vertices[i + 1] *= spxe.ratio.height;
-    }
-    
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+#define SPXE_INFO_INITIALIZER {                                     \
+    NULL, 0, {400, 300}, {800, 600}, {1.0, 1.0},                    \
+    {0, 0, 0.0, 0.0, {0}, {0}, {0}, {0}, {0}, 0, 0, {0}},           \
+    {0, 0, {{0, 0, 0, 0, 0, 0, 0.0}}}, {NULL, NULL, 1}, 0,          \
+    {SPXE_FORMAT_RGBA, 0, {{0, 0, 0, 0}}},                          \
+    {SPXE_UPLOAD_DIRECT, 0, 0, 0, {0}, {NULL}, {NULL}},             \
+    {0, 0, 0, {{0, 0, 0, 0}}, {{0, 0, 0, 0}}},                      \
+    {SPXE_VSYNC_ON, 0.0, 0.0, NULL, NULL, 0.0, 0.0, 0.0, 0.0, 1},   \
+    {0.0, 0, 0, 0, 0, 0, 0.0, 0.0}, {0, 0, 0.0, 1},                 \
+    {0.0, 0.0, 0.0, NULL, NULL},                                    \
+    {NULL, NULL, {{0, NULL, 0, 0, NULL, NULL}}},                    \
+    {NULL, SPXE_RECORD_OFF, 0.0, 0.0}, {1, NULL, NULL, NULL},       \
+    {0, 0, 0.0, NULL, {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0},     \
+     {{0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0}}}                    \
+    SPXE_INFO_THREAD                                                \
+    SPXE_INFO_CAPTURE                                               \
+    SPXE_INFO_SHARE                                                 \
 }
 
-static void spxeKeyboard(GLFWwindow* win, int key, int code, int action, int mod)
-{
-    (void)win;
-    (void)code;
+/* every thread works on its current context, the default one at first */
 
-    if (key < 128 && !spxe.input.keys[key]) {
-        if (mod == GLFW_MOD_CAPS_LOCK || mod == GLFW_MOD_SHIFT || key < 65) {
-            spxe.input.memChar = key;
-        }
-        else spxe.input.memChar = key + 32;
-        spxe.input.queuedChar = 1;
-    }
+#ifndef SPXE_THREAD_LOCAL
+#if defined(_MSC_VER)
+    #define SPXE_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    #define SPXE_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) || defined(__clang__)
+    #define SPXE_THREAD_LOCAL __thread
+#else
+    #error "spxe needs thread local storage, define SPXE_THREAD_LOCAL (empty for a single thread)"
+#endif
+#endif /* SPXE_THREAD_LOCAL */
 
-    spxe.input.keys[key] = action;
-    spxe.input.pressedKeys[key] = spxe.input.pressedKeys[key] * (action != 0);
-}
+static struct spxeInfo spxeDefault = SPXE_INFO_INITIALIZER;
+static SPXE_THREAD_LOCAL struct spxeInfo* spxeCurrent = &spxeDefault;
 
-static void spxeWindow(GLFWwindow* window, int width, int height)
-{
-    (void)window;
-#ifndef __APPLE__
-    glViewport(0, 0, width, height);
+#define spxe (*spxeCurrent)
+
+#ifndef SPXE_HEADLESS
+/* glfw is terminated when the last window is closed, windows live on the main thread */
+static int spxeWindowCount = 0;
 #endif
-    spxe.winres.width = width;
-    spxe.winres.height = height;
-    spxeFrame();
-}
 
-/* window and screen size getters */
+/* implementation only static functions */
 
-void spxeWindowSize(int* width, int* height)
-{
-    *width = spxe.winres.width;
-    *height = spxe.winres.height;
-}
+/*
+ * Monotonic wall time. POSIX targets must see CLOCK_MONOTONIC, CPU time
+ * from clock() adds up over parallel contexts and is only left to
+ * platforms with neither it nor C11 timespec_get.
+ */
 
-void spxeScreenSize(int* width, int* height)
+static double spxeClock(void)
 {
-    *width = spxe.scrres.width;
-    *height = spxe.scrres.height;
+#ifdef SPXE_HEADLESS
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#elif defined(TIME_UTC)
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+#else
+    return glfwGetTime();
+#endif
 }
 
-/* time input */
+/* framebuffer pixel formats */
 
-double spxeTime(void)
+static size_t spxePixelSize(void)
 {
-    return glfwGetTime();
+    switch (spxe.pixel.format) {
+        case SPXE_FORMAT_INDEXED: return 1;
+        case SPXE_FORMAT_GRAY: return 1;
+        case SPXE_FORMAT_RGB565: return 2;
+    }
+    return sizeof(Px);
 }
 
-/* keyboard input */
-
-int spxeKeyDown(const int key)
+static void spxePixelFill(void* dst, const size_t count, const Px px)
 {
-    return !!spxe.input.keys[key];
+    size_t i;
+    switch (spxe.pixel.format) {
+        case SPXE_FORMAT_INDEXED:
+            memset(dst, px.r, count);
+            return;
+        case SPXE_FORMAT_GRAY:
+            memset(dst, (77 * px.r + 150 * px.g + 29 * px.b + 128) >> 8, count);
+            return;
+        case SPXE_FORMAT_RGB565: {
+            unsigned short* p = (unsigned short*)dst;
+            const unsigned short c = (unsigned short)(
+                ((px.r >> 3) << 11) | ((px.g >> 2) << 5) | (px.b >> 3)
+            );
+            for (i = 0; i < count; ++i) {
+                p[i] = c;
+            }
+            return;
+        }
+    }
+    for (i = 0; i < count; ++i) {
+        ((Px*)dst)[i] = px;
+    }
 }
 
-int spxeKeyPressed(const int key)
+static int spxeRectTouch(const struct spxeRect* a, const struct spxeRect* b)
 {
-    if (!spxe.input.pressedKeys[key] && spxe.input.keys[key]) {
-        spxe.input.pressedKeys[key] = 1;
-        return 1;
-    }
-    return 0;
+    return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
 }
 
-int spxeKeyReleased(const int key)
+static void spxeRectMerge(struct spxeRect* a, const struct spxeRect* b)
 {
-    if (!spxe.input.keys[key] && spxe.input.pressedKeys[key]) {
-        spxe.input.pressedKeys[key] = 0;
-        return 1;
-    }
-    return 0;
+    a->x0 = a->x0 < b->x0 ? a->x0 : b->x0;
+    a->y0 = a->y0 < b->y0 ? a->y0 : b->y0;
+    a->x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    a->y1 = a->y1 > b->y1 ? a->y1 : b->y1;
 }
 
-char spxeKeyChar(void)
+static void spxeDirtyAdd(struct spxeRect r)
 {
-    char ch = 0;
-    if (spxe.input.queuedChar) {
-        ch = spxe.input.memChar;
-        spxe.input.queuedChar = 0;
+    int i;
+
+    r.x0 = r.x0 < 0 ? 0 : r.x0;
+    r.y0 = r.y0 < 0 ? 0 : r.y0;
+    r.x1 = r.x1 > spxe.scrres.width ? spxe.scrres.width : r.x1;
+    r.y1 = r.y1 > spxe.scrres.height ? spxe.scrres.height : r.y1;
+    if (r.x0 >= r.x1 || r.y0 >= r.y1) {
+        return;
     }
-    return ch;
-}
 
-/* mouse input */
+    /* merge with every region it touches until it stands alone */
+    for (i = 0; i < spxe.dirty.count; ++i) {
+        if (spxeRectTouch(&r, spxe.dirty.rects + i)) {
+            spxeRectMerge(&r, spxe.dirty.rects + i);
+            spxe.dirty.rects[i] = spxe.dirty.rects[--spxe.dirty.count];
+            i = -1;
+        }
+    }
+
+    if (spxe.dirty.count == SPXE_DIRTY_MAX) {
+        for (i = 1; i < spxe.dirty.count; ++i) {
+            spxeRectMerge(&r, spxe.dirty.rects + i);
+        }
+        spxeRectMerge(spxe.dirty.rects, &r);
+        spxe.dirty.count = 1;
+        return;
+    }
+
+    spxe.dirty.rects[spxe.dirty.count++] = r;
+}
+
+static void spxeDirtyFlush(void)
+{
+    memcpy(spxe.dirty.prev, spxe.dirty.rects, spxe.dirty.count * sizeof(struct spxeRect));
+    spxe.dirty.prevcount = spxe.dirty.count;
+    spxe.dirty.count = 0;
+}
+
+/* supersampling, a box filter over factor x factor samples per pixel */
+
+static void spxeSuperAccumulate(unsigned short* acc, const unsigned char* row, const size_t count)
+{
+    size_t i = 0;
+#if defined(SPXE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i* const a = (__m128i*)(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(v, zero)));
+    }
+#elif defined(SPXE_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vld1_u8(row + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        acc[i] += row[i];
+    }
+}
+
+static void spxeSuperReduce(
+    unsigned char* dst, const unsigned short* acc, 
+    const int count, const int channels, const int factor)
+{
+    int x = 0, i, k;
+    const int shift = factor == 4 ? 4 : 2, half = 1 << (shift - 1);
+#if defined(SPXE_SSE2)
+    const __m128i round = _mm_set1_epi16((short)half);
+    if (channels == 4 && factor == 2) {
+        /* two pixels of two samples each per iteration */
+        for (; x + 2 <= count; x += 2) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(acc + x * 8));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(acc + x * 8 + 8));
+            __m128i sum = _mm_unpacklo_epi64(
+                _mm_add_epi16(a, _mm_srli_si128(a, 8)),
+                _mm_add_epi16(b, _mm_srli_si128(b, 8))
+            );
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+            _mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(sum, sum));
+        }
+    } else if (channels == 4 && factor == 4) {
+        for (; x < count; ++x) {
+            int px;
+            __m128i sum = _mm_add_epi16(
+                _mm_loadu_si128((const __m128i*)(acc + x * 16)),
+                _mm_loadu_si128((const __m128i*)(acc + x * 16 + 8))
+            );
+            sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 4);
+            px = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+            memcpy(dst + x * 4, &px, 4);
+        }
+    }
+#elif defined(SPXE_NEON)
+    if (channels == 4 && factor == 2) {
+        for (; x + 2 <= count; x += 2) {
+            const uint16x8_t a = vld1q_u16(acc + x * 8);
+            const uint16x8_t b = vld1q_u16(acc + x * 8 + 8);
+            const uint16x8_t sum = vcombine_u16(
+                vadd_u16(vget_low_u16(a), vget_high_u16(a)),
+                vadd_u16(vget_low_u16(b), vget_high_u16(b))
+            );
+            vst1_u8(dst + x * 4, vmovn_u16(vrshrq_n_u16(sum, 2)));
+        }
+    } else if (channels == 4 && factor == 4) {
+        for (; x < count; ++x) {
+            const uint16x8_t a = vaddq_u16(vld1q_u16(acc + x * 16), vld1q_u16(acc + x * 16 + 8));
+            const uint16x4_t sum = vrshr_n_u16(vadd_u16(vget_low_u16(a), vget_high_u16(a)), 4);
+            const uint8x8_t px = vmovn_u16(vcombine_u16(sum, sum));
+            vst1_lane_u32((uint32_t*)(void*)(dst + x * 4), vreinterpret_u32_u8(px), 0);
+        }
+    }
+#endif
+    for (; x < count; ++x) {
+        for (k = 0; k < channels; ++k) {
+            int sum = half;
+            for (i = 0; i < factor; ++i) {
+                sum += acc[(x * factor + i) * channels + k];
+            }
+            dst[x * channels + k] = (unsigned char)(sum >> shift);
+        }
+    }
+}
+
+/* downsamples a region of the screen, in screen pixels */
+
+static void spxeSuperResolve(const Px* samples, Px* resolved, const struct spxeRect* r)
+{
+    int y, i;
+    const int factor = spxe.super.factor, channels = (int)spxePixelSize();
+    const size_t width = (size_t)spxe.scrres.width;
+    const size_t stride = width * factor * channels;
+    const size_t span = (size_t)(r->x1 - r->x0) * factor * channels;
+    unsigned short* const acc = spxe.super.accum;
+
+    for (y = r->y0; y < r->y1; ++y) {
+        const unsigned char* src = (const unsigned char*)samples + 
+            (size_t)y * factor * stride + (size_t)r->x0 * factor * channels;
+        memset(acc, 0, span * sizeof(unsigned short));
+        for (i = 0; i < factor; ++i) {
+            spxeSuperAccumulate(acc, src + i * stride, span);
+        }
+        spxeSuperReduce(
+            (unsigned char*)resolved + ((size_t)y * width + r->x0) * channels,
+            acc, r->x1 - r->x0, channels, factor
+        );
+    }
+}
+
+#ifndef SPXE_THREADED
+
+/* the frame presented for a framebuffer, downsampled if it holds samples */
+
+static const Px* spxeSuperFrame(const Px* pixbuf)
+{
+    int i;
+    struct spxeRect full;
+    if (spxe.super.factor == 1 || pixbuf != spxe.super.samples) {
+        return pixbuf;
+    }
+
+    if (spxe.dirty.enabled) {
+        for (i = 0; i < spxe.dirty.count; ++i) {
+            spxeSuperResolve(pixbuf, spxe.super.resolved, spxe.dirty.rects + i);
+        }
+        return spxe.super.resolved;
+    }
+
+    full.x0 = 0;
+    full.y0 = 0;
+    full.x1 = spxe.scrres.width;
+    full.y1 = spxe.scrres.height;
+    spxeSuperResolve(pixbuf, spxe.super.resolved, &full);
+    return spxe.super.resolved;
+}
+
+#endif /* SPXE_THREADED */
+
+/* spxeStart hands out the sample framebuffer and keeps the screen one */
+
+static Px* spxeSuperStart(Px* resolved)
+{
+    const int factor = spxe.super.factor;
+    const size_t width = (size_t)spxe.scrres.width * factor;
+    const size_t height = (size_t)spxe.scrres.height * factor;
+    if (factor == 1) {
+        return resolved;
+    }
+
+    /* averaging palette indices or packed 565 words makes no sense */
+    if (spxe.pixel.format != SPXE_FORMAT_RGBA && spxe.pixel.format != SPXE_FORMAT_GRAY) {
+        fprintf(stderr, "spxe only supersamples RGBA and gray framebuffers.\n");
+        spxe.super.factor = 1;
+        return resolved;
+    }
+
+    spxe.super.samples = (Px*)calloc(width * height, spxePixelSize());
+    spxe.super.accum = (unsigned short*)malloc(width * spxePixelSize() * sizeof(unsigned short));
+    if (!spxe.super.samples || !spxe.super.accum) {
+        fprintf(stderr, "spxe failed to allocate supersampled framebuffer.\n");
+        free(spxe.super.samples);
+        free(spxe.super.accum);
+        spxe.super.samples = NULL;
+        spxe.super.accum = NULL;
+        spxe.super.factor = 1;
+        return resolved;
+    }
+
+    spxe.super.resolved = resolved;
+    return spxe.super.samples;
+}
+
+/* input recording, fixed size records in host byte order */
+
+static void spxeRecordWrite(const spxeEvent* e)
+{
+    unsigned char record[SPXE_RECORD_SIZE];
+    record[0] = (unsigned char)e->type;
+    record[1] = (unsigned char)e->action;
+    record[2] = (unsigned char)e->mods;
+    record[3] = 0;
+    memcpy(record + 4, &e->code, 4);
+    memcpy(record + 8, &e->x, 4);
+    memcpy(record + 12, &e->y, 4);
+    memcpy(record + 16, &e->time, 8);
+    if (fwrite(record, SPXE_RECORD_SIZE, 1, spxe.record.file) != 1) {
+        fprintf(stderr, "spxe could not write input recording.\n");
+        fclose(spxe.record.file);
+        spxe.record.file = NULL;
+        spxe.record.mode = SPXE_RECORD_OFF;
+    }
+}
+
+static int spxeRecordRead(spxeEvent* e)
+{
+    unsigned char record[SPXE_RECORD_SIZE];
+    if (fread(record, SPXE_RECORD_SIZE, 1, spxe.record.file) != 1) {
+        return 0;
+    }
+
+    e->type = record[0];
+    e->action = record[1];
+    e->mods = record[2];
+    memcpy(&e->code, record + 4, 4);
+    memcpy(&e->x, record + 8, 4);
+    memcpy(&e->y, record + 12, 4);
+    memcpy(&e->time, record + 16, 8);
+    return 1;
+}
+
+/* input events, pushed by the callbacks or by a replay */
+
+static void spxeEventPush(
+    const int type, const int code, const int action, 
+    const int mods, const int x, const int y)
+{
+    spxeEvent* e;
+    const long tail = spxe.events.tail;
+    spxeAtomicStore(&spxe.redraw.pending, 1);
+    spxe.latency.input = spxe.record.mode == SPXE_RECORD_REPLAY ? 
+        spxe.record.event : spxeClock();
+
+    /* recordings keep the events a full queue drops */
+    if (spxe.record.mode == SPXE_RECORD_WRITE) {
+        spxeEvent record;
+        record.type = type;
+        record.code = code;
+        record.action = action;
+        record.mods = mods;
+        record.x = x;
+        record.y = y;
+        record.time = spxe.latency.input;
+        spxeRecordWrite(&record);
+    }
+
+    if (tail - spxeAtomicLoad(&spxe.events.head) >= SPXE_EVENT_QUEUE) {
+        return;
+    }
+
+    e = spxe.events.queue + tail % SPXE_EVENT_QUEUE;
+    e->type = type;
+    e->code = code;
+    e->action = action;
+    e->mods = mods;
+    e->x = x;
+    e->y = y;
+    e->time = spxe.latency.input;
+    spxeAtomicStore(&spxe.events.tail, tail + 1);
+}
+
+static void spxeInputKey(const int key, const int action, const int mod)
+{
+    spxeEventPush(SPXE_EVENT_KEY, key, action, mod, 0, 0);
+    if (key >= 0 && key <= KEY_LAST) {
+        if (key < 128 && !spxe.input.keys[key] && 
+            spxe.input.charTail - spxe.input.charHead < SPXE_CHAR_QUEUE) {
+            char* ch = spxe.input.chars + spxe.input.charTail++ % SPXE_CHAR_QUEUE;
+            if (mod == GLFW_MOD_CAPS_LOCK || mod == GLFW_MOD_SHIFT || key < 65) {
+                *ch = (char)key;
+            }
+            else *ch = (char)(key + 32);
+        }
+
+        spxe.input.keys[key] = action;
+        spxe.input.pressedKeys[key] = spxe.input.pressedKeys[key] * (action != 0);
+    }
+}
+
+static void spxeInputButton(const int button, const int action, const int mod)
+{
+    spxeEventPush(SPXE_EVENT_MOUSE, button, action, mod, 0, 0);
+    if (button >= 0 && button <= MOUSE_LAST) {
+        spxe.input.mouse[button] = (unsigned char)action;
+    }
+}
+
+#ifndef SPXE_HEADLESS
+
+static void spxeRatio(void)
+{
+    const float w = (float)spxe.winres.width / (float)spxe.scrres.width;
+    const float h = (float)spxe.winres.height / (float)spxe.scrres.height;
+    
+    spxe.ratio.width = (h < w) ? (h / w) : 1.0f;
+    spxe.ratio.height = (w < h) ? (w / h) : 1.0f;
+}
+
+static void spxeFrame(void)
+{
+    int i;
+
+    float vertices[16] = {
+        1.0f,   1.0f,   1.0f,   1.0f,
+        1.0f,  -1.0f,   1.0f,   0.0f,
+        -1.0f, -1.0f,   0.0f,   0.0f,
+        -1.0f,  1.0f,   0.0f,   1.0f
+    };
+
+    for (i = 0; i < 16; i += 4) {
+        vertices[i] *= spxe.ratio.width;
+        vertices[i + 1] *= spxe.ratio.height;
+    }
+    
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+}
+
+static void spxeCursorScreen(const double cx, const double cy, int* x, int* y)
+{
+    const float width = (float)spxe.scrres.width;
+    const float height = (float)spxe.scrres.height;
+    const float hwidth = width * 0.5;
+    const float hheight = height * 0.5;
+    const double dx = cx * (width / (float)spxe.winres.width);
+    const double dy = height - cy * (height / (float)spxe.winres.height);
+    *x = (int)((dx - hwidth) / spxe.ratio.width + hwidth);
+    *y = (int)((dy - hheight) / spxe.ratio.height + hheight);
+}
+
+static void spxeInputSnapshot(void)
+{
+    spxeCursorScreen(
+        spxe.input.cursorx, spxe.input.cursory, 
+        &spxe.input.mousex, &spxe.input.mousey
+    );
+    memcpy(spxe.input.mouseDown, spxe.input.mouse, sizeof(spxe.input.mouse));
+    spxe.latency.consumed = spxe.latency.input;
+}
+
+/* input latency, from the newest input a frame consumed to its swap */
+
+static void spxeLatencyRecord(const double stamp, const double swapped)
+{
+    if (stamp > spxe.latency.recorded) {
+        spxe.stats.current.latency = swapped - stamp;
+        spxe.latency.recorded = stamp;
+    }
+}
+
+/* callbacks work on the context of their window */
+
+static struct spxeInfo* spxeWindowContext(GLFWwindow* window)
+{
+    struct spxeInfo* const current = spxeCurrent;
+    spxeCurrent = (struct spxeInfo*)glfwGetWindowUserPointer(window);
+    return current;
+}
+
+static void spxeKeyboard(GLFWwindow* win, int key, int code, int action, int mod)
+{
+    struct spxeInfo* const current = spxeWindowContext(win);
+    (void)code;
+
+    /* live input is ignored while a recording is replayed */
+    if (spxe.record.mode != SPXE_RECORD_REPLAY) {
+        spxeInputKey(key, action, mod);
+    }
+    spxeCurrent = current;
+}
+
+static void spxeText(GLFWwindow* win, unsigned int codepoint)
+{
+    struct spxeInfo* const current = spxeWindowContext(win);
+    if (spxe.record.mode != SPXE_RECORD_REPLAY) {
+        spxeEventPush(SPXE_EVENT_CHAR, (int)codepoint, GLFW_PRESS, 0, 0, 0);
+    }
+    spxeCurrent = current;
+}
+
+static void spxeMouseButton(GLFWwindow* win, int button, int action, int mod)
+{
+    struct spxeInfo* const current = spxeWindowContext(win);
+    if (spxe.record.mode != SPXE_RECORD_REPLAY) {
+        spxeInputButton(button, action, mod);
+    }
+    spxeCurrent = current;
+}
+
+static void spxeCursor(GLFWwindow* win, double x, double y)
+{
+    int sx, sy;
+    struct spxeInfo* const current = spxeWindowContext(win);
+    spxe.input.cursorx = x;
+    spxe.input.cursory = y;
+    spxeCursorScreen(x, y, &sx, &sy);
+    if (spxe.record.mode != SPXE_RECORD_REPLAY) {
+        spxeEventPush(
+            SPXE_EVENT_CURSOR, 0, 0, 0, 
+            sx * spxe.super.factor, sy * spxe.super.factor
+        );
+    }
+#ifdef SPXE_THREADED
+    if (spxe.latency.latch) {
+        pthread_mutex_lock(&spxe.thread.mutex);
+        spxe.thread.latchx = sx;
+        spxe.thread.latchy = sy;
+        pthread_mutex_unlock(&spxe.thread.mutex);
+    }
+#endif
+    spxeCurrent = current;
+}
+
+static void spxeWindow(GLFWwindow* window, int width, int height)
+{
+    struct spxeInfo* const current = spxeWindowContext(window);
+#ifndef SPXE_THREADED
+    GLFWwindow* const context = glfwGetCurrentContext();
+#endif
+    if (spxe.record.mode != SPXE_RECORD_REPLAY) {
+        spxeEventPush(SPXE_EVENT_RESIZE, 0, 0, 0, width, height);
+    }
+#ifdef SPXE_THREADED
+    /* the render thread owns the context and resizes on its next frame */
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.winres.width = width;
+    spxe.winres.height = height;
+    spxeRatio();
+    spxe.thread.resized = 1;
+    pthread_cond_signal(&spxe.thread.cond);
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
+    glfwMakeContextCurrent(window);
+#ifndef __APPLE__
+    glViewport(0, 0, width, height);
+#endif
+    spxe.winres.width = width;
+    spxe.winres.height = height;
+    spxeRatio();
+    spxeFrame();
+    glfwMakeContextCurrent(context);
+#endif
+    spxeCurrent = current;
+}
+
+static void spxeRefresh(GLFWwindow* window)
+{
+    struct spxeInfo* const current = spxeWindowContext(window);
+#ifdef SPXE_THREADED
+    /* the render thread presents its last frame again */
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.thread.resized = 1;
+    pthread_cond_signal(&spxe.thread.cond);
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
+    spxeAtomicStore(&spxe.redraw.pending, 1);
+#endif
+    spxeCurrent = current;
+}
+
+/* on demand redraw */
+
+static int spxeRedrawPending(void)
+{
+    return !spxe.redraw.ondemand || 
+        spxeAtomicLoad(&spxe.redraw.pending) || spxe.dirty.count;
+}
+
+static void spxeRedrawWait(void)
+{
+    if (spxeAtomicLoad(&spxe.redraw.pending)) {
+        glfwPollEvents();
+    } else if (spxe.redraw.timeout > 0.0) {
+        glfwWaitEventsTimeout(spxe.redraw.timeout);
+    } else {
+        glfwWaitEvents();
+    }
+    spxe.stats.last = glfwGetTime();
+}
+
+/* swap interval of the current context */
+
+static void spxeSwapApply(void)
+{
+    int interval = spxe.schedule.interval;
+    if (interval == SPXE_VSYNC_ADAPTIVE &&
+        !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        interval = SPXE_VSYNC_ON;
+    }
+    glfwSwapInterval(interval);
+}
+
+/* sleep until the next frame of the frame limit, handling events */
+
+static void spxeThrottle(void)
+{
+    double now;
+    const double period = spxe.schedule.period;
+    if (period <= 0.0) {
+        return;
+    }
+
+    now = glfwGetTime();
+    spxe.schedule.deadline += period;
+    if (spxe.schedule.deadline < now - period) {
+        spxe.schedule.deadline = now;
+        return;
+    }
+
+    while (now < spxe.schedule.deadline) {
+        glfwWaitEventsTimeout(spxe.schedule.deadline - now);
+        now = glfwGetTime();
+    }
+}
+
+/* texture upload */
+
+static int spxeTextureStorageSupported(void)
+{
+#ifdef __APPLE__
+    return 0;
+#else
+    return GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+#endif
+}
+
+static int spxeBufferStorageSupported(void)
+{
+#ifdef __APPLE__
+    return 0;
+#else
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#endif
+}
+
+static void spxeTextureFormat(GLenum* internal, GLenum* format, GLenum* type)
+{
+    switch (spxe.pixel.format) {
+        case SPXE_FORMAT_INDEXED:
+        case SPXE_FORMAT_GRAY:
+            *internal = GL_R8;
+            *format = GL_RED;
+            *type = GL_UNSIGNED_BYTE;
+            return;
+        case SPXE_FORMAT_RGB565:
+#ifdef GL_RGB565
+            *internal = GL_RGB565;
+#else
+            *internal = GL_RGB8;
+#endif
+            *format = GL_RGB;
+            *type = GL_UNSIGNED_SHORT_5_6_5;
+            return;
+    }
+    *internal = GL_RGBA8;
+    *format = GL_RGBA;
+    *type = GL_UNSIGNED_BYTE;
+}
+
+static void spxePaletteUpload(void)
+{
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, spxe.upload.palette);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, spxe.pixel.palette
+    );
+    glActiveTexture(GL_TEXTURE0);
+}
+
+static void spxeUploadFree(void)
+{
+    int i;
+    for (i = 0; i < SPXE_PBO_COUNT; ++i) {
+        if (spxe.upload.fence[i]) {
+            glDeleteSync((GLsync)spxe.upload.fence[i]);
+            spxe.upload.fence[i] = NULL;
+        }
+        if (spxe.upload.map[i]) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spxe.upload.pbo[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            spxe.upload.map[i] = NULL;
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (spxe.upload.pbo[0]) {
+        glDeleteBuffers(SPXE_PBO_COUNT, spxe.upload.pbo);
+        memset(spxe.upload.pbo, 0, sizeof(spxe.upload.pbo));
+    }
+
+    spxe.upload.mode = SPXE_UPLOAD_DIRECT;
+    spxe.upload.index = 0;
+}
+
+static int spxeUploadInit(const int mode)
+{
+    int i;
+    const GLsizeiptr size = 
+        (GLsizeiptr)spxe.scrres.width * spxe.scrres.height * spxePixelSize();
+
+    spxeUploadFree();
+    if (mode == SPXE_UPLOAD_DIRECT) {
+        return SPXE_UPLOAD_DIRECT;
+    }
+
+    glGenBuffers(SPXE_PBO_COUNT, spxe.upload.pbo);
+    for (i = 0; i < SPXE_PBO_COUNT; ++i) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spxe.upload.pbo[i]);
+#ifndef __APPLE__
+        if (mode == SPXE_UPLOAD_PERSISTENT) {
+            const GLbitfield flags = 
+                GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+            spxe.upload.map[i] = glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER, 0, size, flags
+            );
+            if (!spxe.upload.map[i]) {
+                fprintf(stderr, "spxe failed to map persistent pixel buffer.\n");
+                spxeUploadFree();
+                return SPXE_UPLOAD_DIRECT;
+            }
+            continue;
+        }
+#endif
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    spxe.upload.mode = mode;
+    return mode;
+}
+
+static void spxeUploadDirect(const Px* pixbuf)
+{
+    GLenum internal, format, type;
+    spxeTextureFormat(&internal, &format, &type);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0, 0, 0, spxe.scrres.width, spxe.scrres.height,
+        format, type, pixbuf
+    );
+}
+
+static void spxeUploadRect(const Px* pixbuf, const struct spxeRect* r)
+{
+    GLenum internal, format, type;
+    const size_t offset = 
+        ((size_t)r->y0 * spxe.scrres.width + r->x0) * spxePixelSize();
+    const void* src = pixbuf ? (const void*)((const char*)pixbuf + offset) : 
+                               (const void*)offset;
+    spxeTextureFormat(&internal, &format, &type);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0, r->x0, r->y0, r->x1 - r->x0, r->y1 - r->y0,
+        format, type, src
+    );
+}
+
+/* screenshots, read back from the window through pixel pack buffers */
+
+static void spxeShotRead(void)
+{
+    int i;
+    struct spxeShot* shot;
+    const int width = spxe.winres.width, height = spxe.winres.height;
+    if (!spxe.shot.func) {
+        return;
+    }
+
+    for (i = 0; i < SPXE_SHOT_BUFFERS && spxe.shot.slots[i].fence; ++i);
+    if (i == SPXE_SHOT_BUFFERS) {
+        return;
+    }
+
+    shot = spxe.shot.slots + i;
+    if (!shot->pbo) {
+        glGenBuffers(1, &shot->pbo);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, shot->pbo);
+    if (shot->width != width || shot->height != height) {
+        glBufferData(
+            GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * sizeof(Px), 
+            NULL, GL_STREAM_READ
+        );
+        shot->width = width;
+        shot->height = height;
+    }
+
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    shot->fence = (void*)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    shot->func = spxe.shot.func;
+    shot->data = spxe.shot.data;
+    spxe.shot.func = NULL;
+}
+
+/* delivers finished copies, returns the number still in flight */
+
+static int spxeShotDeliver(const int wait)
+{
+    int i, y, pending = 0;
+    for (i = 0; i < SPXE_SHOT_BUFFERS; ++i) {
+        Img2D image;
+        const unsigned char* map;
+        struct spxeShot* shot = spxe.shot.slots + i;
+        const size_t rowsize = (size_t)shot->width * sizeof(Px);
+        if (!shot->fence) {
+            continue;
+        }
+
+        if (glClientWaitSync(
+                (GLsync)shot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                wait ? (GLuint64)1000000000 : 0) == GL_TIMEOUT_EXPIRED) {
+            ++pending;
+            continue;
+        }
+
+        glDeleteSync((GLsync)shot->fence);
+        shot->fence = NULL;
+        image.width = shot->width;
+        image.height = shot->height;
+        image.channels = 4;
+        image.pixbuf = (unsigned char*)malloc(rowsize * shot->height);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, shot->pbo);
+        map = (const unsigned char*)glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)(rowsize * shot->height), GL_MAP_READ_BIT
+        );
+        if (map && image.pixbuf) {
+            /* the window is read bottom row first */
+            for (y = 0; y < shot->height; ++y) {
+                memcpy(
+                    image.pixbuf + rowsize * (shot->height - 1 - y), 
+                    map + rowsize * y, rowsize
+                );
+            }
+        } else {
+            free(image.pixbuf);
+            image.pixbuf = NULL;
+        }
+
+        if (map) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        shot->func(image, shot->data);
+    }
+    return pending;
+}
+
+static void spxeShotFree(void)
+{
+    int i;
+    spxeShotDeliver(1);
+    for (i = 0; i < SPXE_SHOT_BUFFERS; ++i) {
+        struct spxeShot* shot = spxe.shot.slots + i;
+        if (shot->fence) {
+            glDeleteSync((GLsync)shot->fence);
+        }
+        if (shot->pbo) {
+            glDeleteBuffers(1, &shot->pbo);
+        }
+        memset(shot, 0, sizeof(struct spxeShot));
+    }
+}
+
+static void spxeTextureCreate(const Px* pixbuf)
+{
+    GLenum internal, format, type;
+    const int width = spxe.scrres.width, height = spxe.scrres.height;
+
+    spxeTextureFormat(&internal, &format, &type);
+    glGenTextures(1, &spxe.upload.texture);
+    glBindTexture(GL_TEXTURE_2D, spxe.upload.texture);
+    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    /* immutable storage avoids reallocation checks on every upload */
+#ifndef __APPLE__
+    if (spxeTextureStorageSupported()) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, internal, width, height);
+        spxeUploadDirect(pixbuf);
+    } else
+#endif
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, (GLint)internal, width, height, 0, format, type, pixbuf
+    );
+
+    /* partial uploads address rows of the full framebuffer */
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+}
+
+/* texture and pixel buffers for a new screen resolution */
+
+static void spxeTextureResize(const Px* pixbuf)
+{
+    const int mode = spxe.upload.mode;
+    glDeleteTextures(1, &spxe.upload.texture);
+    spxeTextureCreate(pixbuf);
+    spxeUploadInit(mode);
+    spxeRatio();
+    spxeFrame();
+}
+
+static void spxeUpload(const Px* pixbuf)
+{
+    void* map;
+    int n, y, count = 1;
+    struct spxeRect full;
+    const struct spxeRect* rects = &full;
+    const int i = spxe.upload.index, width = spxe.scrres.width;
+    const size_t bpp = spxePixelSize();
+    const size_t size = (size_t)width * spxe.scrres.height * bpp;
+
+    full.x0 = 0;
+    full.y0 = 0;
+    full.x1 = width;
+    full.y1 = spxe.scrres.height;
+    if (spxe.dirty.enabled) {
+        rects = spxe.dirty.rects;
+        count = spxe.dirty.count;
+    }
+
+    if (spxe.stats.enabled) {
+        for (n = 0; n < count; ++n) {
+            spxe.stats.current.bytes += (double)bpp *
+                (rects[n].x1 - rects[n].x0) * (rects[n].y1 - rects[n].y0);
+        }
+    }
+
+    if (spxe.upload.mode == SPXE_UPLOAD_DIRECT) {
+        for (n = 0; n < count; ++n) {
+            spxeUploadRect(pixbuf, rects + n);
+        }
+        return;
+    }
+
+    if (!count) {
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, spxe.upload.pbo[i]);
+    if (spxe.upload.mode == SPXE_UPLOAD_PERSISTENT) {
+        /* wait until the GPU finished reading this slot of the ring */
+        if (spxe.upload.fence[i]) {
+            glClientWaitSync(
+                (GLsync)spxe.upload.fence[i], 
+                GL_SYNC_FLUSH_COMMANDS_BIT, 
+                (GLuint64)1000000000
+            );
+            glDeleteSync((GLsync)spxe.upload.fence[i]);
+        }
+        map = spxe.upload.map[i];
+    } else {
+        map = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, 
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+        );
+    }
+
+    if (!map) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        spxeUploadDirect(pixbuf);
+        return;
+    }
+
+    /* the pixel buffer mirrors the framebuffer layout */
+    for (n = 0; n < count; ++n) {
+        const struct spxeRect* r = rects + n;
+        const size_t rowsize = (size_t)(r->x1 - r->x0) * bpp;
+        if (rowsize == (size_t)width * bpp) {
+            const size_t offset = (size_t)r->y0 * rowsize;
+            memcpy(
+                (char*)map + offset, (const char*)pixbuf + offset,
+                rowsize * (r->y1 - r->y0)
+            );
+            continue;
+        }
+        for (y = r->y0; y < r->y1; ++y) {
+            const size_t offset = ((size_t)y * width + r->x0) * bpp;
+            memcpy((char*)map + offset, (const char*)pixbuf + offset, rowsize);
+        }
+    }
+
+    if (spxe.upload.mode == SPXE_UPLOAD_PBO) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    /* texture reads from the bound pixel unpack buffer asynchronously */
+    for (n = 0; n < count; ++n) {
+        spxeUploadRect(NULL, rects + n);
+    }
+
+    if (spxe.upload.mode == SPXE_UPLOAD_PERSISTENT) {
+        spxe.upload.fence[i] = (void*)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    spxe.upload.index = (i + 1) % SPXE_PBO_COUNT;
+}
+
+#endif /* SPXE_HEADLESS */
+
+/* contexts */
+
+spxeContext* spxeCreate(void)
+{
+    static const struct spxeInfo init = SPXE_INFO_INITIALIZER;
+    struct spxeInfo* context = (struct spxeInfo*)malloc(sizeof(struct spxeInfo));
+    if (!context) {
+        fprintf(stderr, "spxe failed to allocate context.\n");
+        return NULL;
+    }
+
+    *context = init;
+    return context;
+}
+
+void spxeDestroy(spxeContext* context)
+{
+    struct spxeInfo* previous;
+    if (!context || context == &spxeDefault) {
+        return;
+    }
+
+    /* a started context is ended first, its framebuffer is left to the caller */
+    previous = spxeMakeCurrent(context);
+    if (spxe.started) {
+        spxeEnd(NULL);
+    }
+    spxeMakeCurrent(previous == context ? NULL : previous);
+    free(context);
+}
+
+spxeContext* spxeMakeCurrent(spxeContext* context)
+{
+    struct spxeInfo* const current = spxeCurrent;
+    spxeCurrent = context ? context : &spxeDefault;
+#if !defined SPXE_HEADLESS && !defined SPXE_THREADED
+    if (spxe.window && spxe.window != glfwGetCurrentContext()) {
+        glfwMakeContextCurrent(spxe.window);
+    }
+#endif
+    return current;
+}
+
+/* window and screen size getters */
+
+void spxeWindowSize(int* width, int* height)
+{
+    *width = spxe.winres.width;
+    *height = spxe.winres.height;
+}
+
+void spxeScreenSize(int* width, int* height)
+{
+    *width = spxe.scrres.width * spxe.super.factor;
+    *height = spxe.scrres.height * spxe.super.factor;
+}
+
+/* time input */
+
+static double spxeTimeNow(void)
+{
+#ifdef SPXE_HEADLESS
+    return (double)spxe.frame / (double)SPXE_HEADLESS_FPS;
+#else
+    return glfwGetTime();
+#endif
+}
+
+double spxeTime(void)
+{
+    if (spxe.record.mode != SPXE_RECORD_OFF) {
+        return spxe.record.time;
+    }
+    return spxeTimeNow();
+}
+
+/* screenshots */
+
+int spxeScreenshot(spxeShotFunc shot, void* data)
+{
+#ifdef SPXE_HEADLESS
+    (void)shot;
+    (void)data;
+    return 0;
+#else
+    int requested = 0;
+#ifdef SPXE_THREADED
+    pthread_mutex_lock(&spxe.thread.mutex);
+#endif
+    if (!spxe.shot.func) {
+        spxe.shot.func = shot;
+        spxe.shot.data = data;
+        requested = 1;
+    }
+#ifdef SPXE_THREADED
+    if (spxe.redraw.ondemand) {
+        spxe.thread.resized = 1;
+        pthread_cond_signal(&spxe.thread.cond);
+    }
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
+    spxeAtomicStore(&spxe.redraw.pending, 1);
+#endif
+    return requested;
+#endif
+}
+
+/* input recording and replay */
+
+static void spxeRecordFrame(void)
+{
+    spxeEvent frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.x = spxe.input.mousex;
+    frame.y = spxe.input.mousey;
+    frame.time = spxe.record.time;
+    spxeRecordWrite(&frame);
+}
+
+static int spxeReplayFrame(void)
+{
+    spxeEvent e;
+    while (spxeRecordRead(&e)) {
+        /* a frame record closes the events polled during that frame */
+        if (!e.type) {
+            spxe.record.time = e.time;
+            spxe.input.mousex = e.x;
+            spxe.input.mousey = e.y;
+            return 1;
+        }
+
+        spxe.record.event = e.time;
+        if (e.type == SPXE_EVENT_KEY) {
+            spxeInputKey(e.code, e.action, e.mods);
+        } else if (e.type == SPXE_EVENT_MOUSE) {
+            spxeInputButton(e.code, e.action, e.mods);
+        } else spxeEventPush(e.type, e.code, e.action, e.mods, e.x, e.y);
+    }
+
+    spxeRecordStop();
+    return 0;
+}
+
+/* per frame input state, returns 0 when a replay is over */
+
+static int spxeInputFrame(void)
+{
+    int status = 1;
+    if (spxe.record.mode == SPXE_RECORD_REPLAY) {
+        status = spxeReplayFrame();
+        memcpy(spxe.input.mouseDown, spxe.input.mouse, sizeof(spxe.input.mouse));
+        spxe.latency.consumed = spxe.latency.input;
+        return status;
+    }
+
+#ifndef SPXE_HEADLESS
+    spxeInputSnapshot();
+#endif
+    if (spxe.record.mode == SPXE_RECORD_WRITE) {
+        spxe.record.time = spxeTimeNow();
+        spxeRecordFrame();
+    }
+    return status;
+}
+
+static FILE* spxeRecordOpen(const char* path, const char* mode)
+{
+    FILE* file;
+    spxeRecordStop();
+    file = fopen(path, mode);
+    if (!file) {
+        fprintf(stderr, "spxe could not open input recording '%s'.\n", path);
+    }
+    return file;
+}
+
+int spxeRecordStart(const char* path)
+{
+    int header[4];
+    FILE* file = spxeRecordOpen(path, "wb");
+    if (!file) {
+        return 0;
+    }
+
+    memcpy(header, "SPXR", 4);
+    header[1] = 1;
+    header[2] = spxe.scrres.width;
+    header[3] = spxe.scrres.height;
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        fprintf(stderr, "spxe could not write input recording '%s'.\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    spxe.record.file = file;
+    spxe.record.mode = SPXE_RECORD_WRITE;
+    spxe.record.time = spxeTimeNow();
+    spxeRecordFrame();
+    return spxe.record.mode == SPXE_RECORD_WRITE;
+}
+
+int spxeReplayStart(const char* path)
+{
+    int header[4];
+    FILE* file = spxeRecordOpen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    if (fread(header, sizeof(header), 1, file) != 1 || 
+        memcmp(header, "SPXR", 4) || header[1] != 1) {
+        fprintf(stderr, "spxe input recording '%s' is not valid.\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    if (header[2] != spxe.scrres.width || header[3] != spxe.scrres.height) {
+        fprintf(
+            stderr, "spxe input recording '%s' was made at %dx%d.\n", 
+            path, header[2], header[3]
+        );
+    }
+
+    spxe.record.file = file;
+    spxe.record.mode = SPXE_RECORD_REPLAY;
+    return spxeInputFrame();
+}
+
+void spxeRecordStop(void)
+{
+    if (spxe.record.file) {
+        fclose(spxe.record.file);
+    }
+    spxe.record.file = NULL;
+    spxe.record.mode = SPXE_RECORD_OFF;
+}
+
+/* keyboard input */
+
+int spxeKeyDown(const int key)
+{
+    return !!spxe.input.keys[key];
+}
+
+int spxeKeyPressed(const int key)
+{
+    if (!spxe.input.pressedKeys[key] && spxe.input.keys[key]) {
+        spxe.input.pressedKeys[key] = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int spxeKeyReleased(const int key)
+{
+    if (!spxe.input.keys[key] && spxe.input.pressedKeys[key]) {
+        spxe.input.pressedKeys[key] = 0;
+        return 1;
+    }
+    return 0;
+}
+
+char spxeKeyChar(void)
+{
+    if (spxe.input.charHead == spxe.input.charTail) {
+        return 0;
+    }
+    return spxe.input.chars[spxe.input.charHead++ % SPXE_CHAR_QUEUE];
+}
+
+/* input events */
+
+int spxeEventPoll(spxeEvent* event)
+{
+    const long head = spxe.events.head;
+    if (head == spxeAtomicLoad(&spxe.events.tail)) {
+        return 0;
+    }
+
+    *event = spxe.events.queue[head % SPXE_EVENT_QUEUE];
+    spxeAtomicStore(&spxe.events.head, head + 1);
+    return 1;
+}
+
+/* mouse input */
 
 void spxeMousePos(int* x, int* y)
 {
-    double dx, dy;
-    float width, height, hwidth, hheight;
-    
-    glfwGetCursorPos(spxe.window, &dx, &dy);
-    width = (float)spxe.scrres.width;
-    height = (float)spxe.scrres.height;
-    hwidth = width * 0.5;
-    hheight = height * 0.5;
-
-    dx = dx * (width / (float)spxe.winres.width);
-    dy = height - dy * (height / (float)spxe.winres.height);
-    *x = (int)((dx - hwidth) / spxe.ratio.width + hwidth);
-    *y = (int)((dy - hheight) / spxe.ratio.height + hheight);
+    *x = spxe.input.mousex * spxe.super.factor;
+    *y = spxe.input.mousey * spxe.super.factor;
+}
+
+int spxeMouseDown(const int button)
+{
+    return spxe.input.mouseDown[button];
+}
+
+int spxeMousePressed(const int button)
+{
+    const int pressed = spxe.input.mouseDown[button] && 
+                        !spxe.input.pressedMouse[button];
+    spxe.input.pressedMouse[button] = spxe.input.mouseDown[button];
+    return pressed;
+}
+
+int spxeMouseReleased(const int button)
+{
+    return !spxe.input.mouseDown[button];
+}
+
+#ifdef SPXE_HEADLESS
+
+void spxeMouseVisible(const int visible)
+{
+    (void)visible;
+}
+
+#else /* SPXE_HEADLESS */
+
+void spxeMouseVisible(const int visible)
+{
+    glfwSetInputMode(
+        spxe.window, GLFW_CURSOR, 
+        !visible ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL
+    );
+}
+
+#endif /* SPXE_HEADLESS */
+
+/* frame sink and counter */
+
+void spxeFrameSink(spxeSinkFunc sink, void* data)
+{
+    spxe.sink.func = sink;
+    spxe.sink.data = data;
+}
+
+long spxeFrameCount(void)
+{
+    return spxe.frame;
+}
+
+/* framebuffer pixel formats */
+
+int spxePixelFormat(const int format)
+{
+    const int valid = format >= SPXE_FORMAT_RGBA && format <= SPXE_FORMAT_RGB565;
+    spxe.pixel.format = valid ? format : SPXE_FORMAT_RGBA;
+    return spxe.pixel.format;
+}
+
+int spxeSupersample(const int factor)
+{
+    spxe.super.factor = factor == 2 || factor == 4 ? factor : 1;
+    return spxe.super.factor;
+}
+
+void spxePalette(const Px* colors, const int count)
+{
+    const int n = count < 0 ? 0 : count > 256 ? 256 : count;
+#ifdef SPXE_THREADED
+    pthread_mutex_lock(&spxe.thread.mutex);
+    memcpy(spxe.pixel.palette, colors, n * sizeof(Px));
+    spxe.pixel.paletted = 1;
+    if (spxe.upload.palette) {
+        spxe.thread.paletted = 1;
+        pthread_cond_signal(&spxe.thread.cond);
+    }
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
+    memcpy(spxe.pixel.palette, colors, n * sizeof(Px));
+    spxe.pixel.paletted = 1;
+#ifndef SPXE_HEADLESS
+    if (spxe.upload.palette) {
+        spxePaletteUpload();
+    }
+#endif
+#endif
+}
+
+/* dynamic resolution */
+
+static int spxeScaleUpdate(int* width, int* height)
+{
+    int w;
+    double work;
+    if (spxe.scale.fps <= 0.0 || spxe.scale.returned <= 0.0) {
+        return 0;
+    }
+#ifdef SPXE_CAPTURE
+    if (spxe.capture.scratch) {
+        return 0;
+    }
+#endif
+#ifdef SPXE_SHARED
+    if (spxe.share.header) {
+        return 0;
+    }
+#endif
+    if (spxe.super.factor > 1) {
+        return 0;
+    }
+
+    /* smoothed time spent drawing since spxePresent returned */
+    work = spxeClock() - spxe.scale.returned;
+    spxe.scale.work = spxe.scale.work > 0.0 ? spxe.scale.work * 0.9 + work * 0.1 : work;
+    if (spxe.scale.cooldown > 0) {
+        --spxe.scale.cooldown;
+        return 0;
+    }
+
+    w = spxe.scrres.width;
+    if (spxe.scale.work > 0.9 / spxe.scale.fps) {
+        w = w * 9 / 10;
+    } else if (spxe.scale.work < 0.6 / spxe.scale.fps) {
+        w = w * 11 / 10 + 1;
+    }
+
+    w = w < spxe.scale.minwidth ? spxe.scale.minwidth : w;
+    w = w > spxe.scale.maxwidth ? spxe.scale.maxwidth : w;
+    if (w == spxe.scrres.width) {
+        return 0;
+    }
+
+    *width = w;
+    *height = (int)((double)w * spxe.scale.baseheight / spxe.scale.basewidth + 0.5);
+    *height = *height < 1 ? 1 : *height;
+    spxe.scale.cooldown = SPXE_SCALE_COOLDOWN;
+    spxe.scale.work = 0.0;
+    return 1;
+}
+
+void spxeDynamicScale(const double fps, const int minwidth, const int maxwidth)
+{
+    spxe.scale.fps = fps;
+    spxe.scale.minwidth = minwidth > 0 ? minwidth : 1;
+    spxe.scale.maxwidth = maxwidth > spxe.scale.minwidth ? maxwidth : spxe.scale.minwidth;
+    spxe.scale.cooldown = SPXE_SCALE_COOLDOWN;
+    spxe.scale.work = 0.0;
+    spxe.scale.returned = 0.0;
+}
+
+/* on demand redraw */
+
+void spxeRedrawOnDemand(const int enable, const double timeout)
+{
+    spxe.redraw.ondemand = enable;
+    spxe.redraw.timeout = timeout;
+    spxeAtomicStore(&spxe.redraw.pending, 1);
+}
+
+void spxeRedraw(void)
+{
+    spxeAtomicStore(&spxe.redraw.pending, 1);
+#ifndef SPXE_HEADLESS
+    if (spxe.redraw.ondemand && spxe.window) {
+        glfwPostEmptyEvent();
+    }
+#endif
+}
+
+/* frame pacing */
+
+void spxeSwapInterval(const int interval)
+{
+    spxe.schedule.interval = interval;
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        pthread_mutex_lock(&spxe.thread.mutex);
+        spxe.thread.intervaled = 1;
+        pthread_cond_signal(&spxe.thread.cond);
+        pthread_mutex_unlock(&spxe.thread.mutex);
+    }
+#elif !defined SPXE_HEADLESS
+    if (spxe.window) {
+        spxeSwapApply();
+    }
+#endif
+}
+
+void spxeFrameLimit(const double fps)
+{
+    /* the limiter sleeps on the wall clock, never on recorded or replayed time */
+    spxe.schedule.period = fps > 0.0 ? 1.0 / fps : 0.0;
+    spxe.schedule.deadline = spxeTimeNow();
+}
+
+void spxeFixedUpdate(
+    spxeUpdateFunc update,  void* data, 
+    const double rate,      const int maxsteps)
+{
+    spxe.schedule.update = rate > 0.0 ? update : NULL;
+    spxe.schedule.data = data;
+    spxe.schedule.step = rate > 0.0 ? 1.0 / rate : 0.0;
+    spxe.schedule.maxsteps = maxsteps > 1 ? maxsteps : 1;
+    spxe.schedule.last = spxeTime();
+    spxe.schedule.accumulator = 0.0;
+    spxe.schedule.alpha = 0.0;
+}
+
+double spxeFixedAlpha(void)
+{
+    return spxe.schedule.alpha;
+}
+
+static void spxeScheduleUpdate(void)
+{
+    int steps;
+    double now;
+    const double step = spxe.schedule.step;
+    if (!spxe.schedule.update) {
+        return;
+    }
+
+    now = spxeTime();
+    spxe.schedule.accumulator += now - spxe.schedule.last;
+    spxe.schedule.last = now;
+    
+    for (steps = 0; spxe.schedule.accumulator >= step; ++steps) {
+        if (steps == spxe.schedule.maxsteps) {
+            /* too far behind, drop whole steps instead of spiraling */
+            spxe.schedule.accumulator -= step * (double)(long)(spxe.schedule.accumulator / step);
+            break;
+        }
+        spxe.schedule.update(step, spxe.schedule.data);
+        spxe.schedule.accumulator -= step;
+    }
+
+    spxe.schedule.alpha = spxe.schedule.accumulator / step;
+}
+
+/* input latency */
+
+void spxeLateLatch(spxeLatchFunc latch, void* data)
+{
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        pthread_mutex_lock(&spxe.thread.mutex);
+    }
+#endif
+    spxe.latency.latch = latch;
+    spxe.latency.data = data;
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        pthread_mutex_unlock(&spxe.thread.mutex);
+    }
+#endif
+}
+
+/* timing statistics */
+
+static void spxeStatsCommit(void)
+{
+    const double now = spxeClock();
+    struct spxeFrameTimes* f = spxe.stats.frames + spxe.stats.count % SPXE_STATS_FRAMES;
+    *f = spxe.stats.current;
+    f->frame = now - spxe.stats.last;
+    spxe.stats.last = now;
+    ++spxe.stats.count;
+    memset(&spxe.stats.current, 0, sizeof(spxe.stats.current));
+}
+
+static int spxeStatsCompare(const void* a, const void* b)
+{
+    const double n = *(const double*)a, m = *(const double*)b;
+    return (n > m) - (n < m);
+}
+
+static spxeStats spxeStatsCompute(void)
+{
+    int i, inputs = 0;
+    spxeStats stats;
+    double times[SPXE_STATS_FRAMES], latencies[SPXE_STATS_FRAMES];
+    double limit, uploadtime = 0.0, bytes = 0.0;
+    const int count = (int)(spxe.stats.count < SPXE_STATS_FRAMES ? 
+                            spxe.stats.count : SPXE_STATS_FRAMES);
+    
+    memset(&stats, 0, sizeof(stats));
+    stats.frames = count;
+    if (!count) {
+        return stats;
+    }
+
+    for (i = 0; i < count; ++i) {
+        const struct spxeFrameTimes* f = spxe.stats.frames + i;
+        times[i] = f->frame;
+        stats.upload += f->upload;
+        stats.draw += f->draw;
+        stats.sink += f->sink;
+        stats.poll += f->poll;
+        stats.swap += f->swap;
+        uploadtime += f->upload;
+        bytes += f->bytes;
+        if (f->latency > 0.0) {
+            latencies[inputs++] = f->latency;
+        }
+    }
+
+    stats.upload /= count;
+    stats.draw /= count;
+    stats.sink /= count;
+    stats.poll /= count;
+    stats.swap /= count;
+    stats.bandwidth = uploadtime > 0.0 ? bytes / uploadtime : 0.0;
+
+    qsort(times, count, sizeof(double), spxeStatsCompare);
+    stats.p50 = times[(count - 1) * 50 / 100];
+    stats.p95 = times[(count - 1) * 95 / 100];
+    stats.p99 = times[(count - 1) * 99 / 100];
+
+    limit = 1.5 * (spxe.schedule.period > 0.0 ? spxe.schedule.period : stats.p50);
+    for (i = 0; i < count; ++i) {
+        stats.dropped += times[i] > limit;
+    }
+
+    if (inputs) {
+        qsort(latencies, inputs, sizeof(double), spxeStatsCompare);
+        stats.latency50 = latencies[(inputs - 1) * 50 / 100];
+        stats.latency95 = latencies[(inputs - 1) * 95 / 100];
+        stats.latency99 = latencies[(inputs - 1) * 99 / 100];
+    }
+
+    return stats;
+}
+
+static void spxeStatsWrite(const char* path)
+{
+    long i, start;
+    FILE* file;
+    spxeStats stats;
+    const size_t len = strlen(path);
+    const int json = len >= 5 && !strcmp(path + len - 5, ".json");
+    
+    file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "spxe could not write frame statistics to '%s'.\n", path);
+        return;
+    }
+
+    stats = spxeStatsCompute();
+    start = spxe.stats.count > SPXE_STATS_FRAMES ? spxe.stats.count - SPXE_STATS_FRAMES : 0;
+    if (json) {
+        fprintf(
+            file, "{\n\"frames\": %ld,\n\"dropped\": %ld,\n"
+            "\"p50\": %f,\n\"p95\": %f,\n\"p99\": %f,\n\"bandwidth\": %f,\n"
+            "\"latency50\": %f,\n\"latency95\": %f,\n\"latency99\": %f,\n"
+            "\"records\": [\n", stats.frames, stats.dropped, 
+            stats.p50, stats.p95, stats.p99, stats.bandwidth,
+            stats.latency50, stats.latency95, stats.latency99
+        );
+    } else {
+        fprintf(file, "frame,time,upload,draw,sink,poll,swap,bytes,latency\n");
+    }
+
+    for (i = start; i < spxe.stats.count; ++i) {
+        const struct spxeFrameTimes* f = spxe.stats.frames + i % SPXE_STATS_FRAMES;
+        fprintf(
+            file, json ? 
+            "{\"frame\": %ld, \"time\": %f, \"upload\": %f, \"draw\": %f, "
+            "\"sink\": %f, \"poll\": %f, \"swap\": %f, \"bytes\": %.0f, "
+            "\"latency\": %f}%s\n" :
+            "%ld,%f,%f,%f,%f,%f,%f,%.0f,%f%s\n",
+            i, f->frame, f->upload, f->draw, f->sink, f->poll, f->swap, f->bytes,
+            f->latency, json && i + 1 < spxe.stats.count ? "," : ""
+        );
+    }
+
+    if (json) {
+        fprintf(file, "]\n}\n");
+    }
+    fclose(file);
+}
+
+void spxeStatsRecord(const int enable)
+{
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        pthread_mutex_lock(&spxe.thread.mutex);
+    }
+#endif
+    spxe.stats.enabled = enable;
+    spxe.stats.count = 0;
+    spxe.stats.last = spxeClock();
+    memset(&spxe.stats.current, 0, sizeof(spxe.stats.current));
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        pthread_mutex_unlock(&spxe.thread.mutex);
+    }
+#endif
+}
+
+void spxeStatsDump(const char* path)
+{
+    spxe.stats.dump = path;
+}
+
+spxeStats spxeStatsQuery(void)
+{
+    spxeStats stats;
+#ifdef SPXE_THREADED
+    pthread_mutex_lock(&spxe.thread.mutex);
+    stats = spxeStatsCompute();
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
+    stats = spxeStatsCompute();
+#endif
+    return stats;
+}
+
+/* frame capture */
+
+#ifdef SPXE_CAPTURE
+
+static int spxeCaptureWrite(const int fd, const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+    while (size) {
+        const ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+static unsigned char spxeCaptureByte(const int n)
+{
+    return (unsigned char)(n > 255 ? 255 : n);
+}
+
+static Px spxeCapturePixel(const void* pixbuf, const size_t i)
+{
+    Px p;
+    const unsigned char* bytes = (const unsigned char*)pixbuf;
+    switch (spxe.pixel.format) {
+        case SPXE_FORMAT_INDEXED: 
+            return spxe.pixel.palette[bytes[i]];
+        case SPXE_FORMAT_GRAY:
+            p.r = p.g = p.b = bytes[i];
+            p.a = 255;
+            return p;
+        case SPXE_FORMAT_RGB565: {
+            const unsigned int c = ((const unsigned short*)pixbuf)[i];
+            p.r = (unsigned char)(((c >> 11) * 527 + 23) >> 6);
+            p.g = (unsigned char)((((c >> 5) & 63) * 259 + 33) >> 6);
+            p.b = (unsigned char)(((c & 31) * 527 + 23) >> 6);
+            p.a = 255;
+            return p;
+        }
+    }
+    return ((const Px*)pixbuf)[i];
+}
+
+/* full range BT.601 4:2:0, the bottom framebuffer row is the last one */
+
+static size_t spxeCaptureY4M(const Px* pixbuf, unsigned char* out)
+{
+    int x, y, i, j;
+    const int w = spxe.scrres.width, h = spxe.scrres.height;
+    const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    unsigned char* cb = out + w * h;
+    unsigned char* cr = cb + cw * ch;
+
+    for (y = 0; y < h; ++y) {
+        const size_t row = (size_t)(h - 1 - y) * w;
+        for (x = 0; x < w; ++x) {
+            const Px p = spxeCapturePixel(pixbuf, row + x);
+            *out++ = (unsigned char)((77 * p.r + 150 * p.g + 29 * p.b + 128) >> 8);
+        }
+    }
+
+    for (y = 0; y < ch; ++y) {
+        for (x = 0; x < cw; ++x) {
+            int r = 0, g = 0, b = 0;
+            for (j = 0; j < 2; ++j) {
+                const int py = h - 1 - (2 * y + j < h ? 2 * y + j : h - 1);
+                for (i = 0; i < 2; ++i) {
+                    const int px = 2 * x + i < w ? 2 * x + i : w - 1;
+                    const Px p = spxeCapturePixel(pixbuf, (size_t)py * w + px);
+                    r += p.r;
+                    g += p.g;
+                    b += p.b;
+                }
+            }
+            *cb++ = spxeCaptureByte((-43 * r - 85 * g + 128 * b + 131584) >> 10);
+            *cr++ = spxeCaptureByte((128 * r - 107 * g - 21 * b + 131584) >> 10);
+        }
+    }
+
+    return (size_t)w * h + 2 * (size_t)cw * ch;
+}
+
+static size_t spxeCaptureRaw(const Px* pixbuf, unsigned char* out)
+{
+    int x, y;
+    const int w = spxe.scrres.width, h = spxe.scrres.height;
+    const size_t rowsize = (size_t)w * sizeof(Px);
+    for (y = 0; y < h; ++y) {
+        const size_t row = (size_t)(h - 1 - y) * w;
+        if (spxe.pixel.format == SPXE_FORMAT_RGBA) {
+            memcpy(out + y * rowsize, pixbuf + row, rowsize);
+            continue;
+        }
+        for (x = 0; x < w; ++x) {
+            const Px p = spxeCapturePixel(pixbuf, row + x);
+            memcpy(out + y * rowsize + x * sizeof(Px), &p, sizeof(Px));
+        }
+    }
+    return rowsize * h;
+}
+
+static void* spxeCaptureLoop(void* arg)
+{
+    size_t size;
+    const Px* pixbuf;
+    struct spxeCapture* capture;
+
+    spxeCurrent = (struct spxeInfo*)arg;
+    capture = &spxe.capture;
+    pthread_mutex_lock(&capture->mutex);
+    while (1) {
+        while (capture->running && !capture->count) {
+            pthread_cond_wait(&capture->cond, &capture->mutex);
+        }
+
+        /* queued frames are still written after a stop */
+        if (!capture->count) {
+            break;
+        }
+
+        pixbuf = capture->buffers[capture->head];
+        pthread_mutex_unlock(&capture->mutex);
+
+        if (capture->format == SPXE_CAPTURE_Y4M) {
+            size = spxeCaptureY4M(pixbuf, capture->scratch);
+            capture->failed = !spxeCaptureWrite(capture->fd, "FRAME\n", 6);
+        } else {
+            size = spxeCaptureRaw(pixbuf, capture->scratch);
+        }
+        if (!capture->failed) {
+            capture->failed = !spxeCaptureWrite(capture->fd, capture->scratch, size);
+        }
+
+        pthread_mutex_lock(&capture->mutex);
+        capture->head = (capture->head + 1) % SPXE_CAPTURE_BUFFERS;
+        --capture->count;
+        pthread_cond_broadcast(&capture->cond);
+        if (capture->failed) {
+            fprintf(stderr, "spxe failed to write captured frame.\n");
+            capture->running = 0;
+            capture->count = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&capture->mutex);
+    return NULL;
+}
+
+static void spxeCapturePush(const Px* pixbuf)
+{
+    struct spxeCapture* capture = &spxe.capture;
+    const size_t size = 
+        (size_t)spxe.scrres.width * spxe.scrres.height * spxePixelSize();
+
+    pthread_mutex_lock(&capture->mutex);
+    while (capture->running && capture->count == SPXE_CAPTURE_BUFFERS) {
+        pthread_cond_wait(&capture->cond, &capture->mutex);
+    }
+    if (capture->running) {
+        const int i = (capture->head + capture->count) % SPXE_CAPTURE_BUFFERS;
+        memcpy(capture->buffers[i], pixbuf, size);
+        ++capture->count;
+        pthread_cond_broadcast(&capture->cond);
+    }
+    pthread_mutex_unlock(&capture->mutex);
+}
+
+static void spxeCaptureFree(void)
+{
+    int i;
+    for (i = 0; i < SPXE_CAPTURE_BUFFERS; ++i) {
+        free(spxe.capture.buffers[i]);
+        spxe.capture.buffers[i] = NULL;
+    }
+    free(spxe.capture.scratch);
+    spxe.capture.scratch = NULL;
+}
+
+int spxeCaptureStart(const int fd, const int format, const double fps)
+{
+    int i;
+    char header[128];
+    const int w = spxe.scrres.width, h = spxe.scrres.height;
+    const size_t size = (size_t)w * h * sizeof(Px);
+    
+    spxeCaptureStop();
+    for (i = 0; i < SPXE_CAPTURE_BUFFERS; ++i) {
+        spxe.capture.buffers[i] = (Px*)malloc(size);
+        if (!spxe.capture.buffers[i]) {
+            break;
+        }
+    }
+    spxe.capture.scratch = (unsigned char*)malloc(size);
+    if (i < SPXE_CAPTURE_BUFFERS || !spxe.capture.scratch) {
+        fprintf(stderr, "spxe failed to allocate capture buffers.\n");
+        spxeCaptureFree();
+        return 0;
+    }
+
+    if (format == SPXE_CAPTURE_Y4M) {
+        const long rate = (long)((fps > 0.0 ? fps : 60.0) * 1000.0 + 0.5);
+        sprintf(
+            header, "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", 
+            w, h, rate
+        );
+        if (!spxeCaptureWrite(fd, header, strlen(header))) {
+            fprintf(stderr, "spxe failed to write capture header.\n");
+            spxeCaptureFree();
+            return 0;
+        }
+    }
+
+    spxe.capture.fd = fd;
+    spxe.capture.format = format == SPXE_CAPTURE_Y4M ? format : SPXE_CAPTURE_RAW;
+    spxe.capture.head = 0;
+    spxe.capture.count = 0;
+    spxe.capture.failed = 0;
+    pthread_mutex_lock(&spxe.capture.mutex);
+    spxe.capture.running = 1;
+    pthread_mutex_unlock(&spxe.capture.mutex);
+    if (pthread_create(&spxe.capture.thread, NULL, spxeCaptureLoop, spxeCurrent)) {
+        fprintf(stderr, "spxe failed to start capture thread.\n");
+        pthread_mutex_lock(&spxe.capture.mutex);
+        spxe.capture.running = 0;
+        pthread_mutex_unlock(&spxe.capture.mutex);
+        spxeCaptureFree();
+        return 0;
+    }
+
+    return 1;
+}
+
+void spxeCaptureStop(void)
+{
+    if (!spxe.capture.scratch) {
+        return;
+    }
+
+    pthread_mutex_lock(&spxe.capture.mutex);
+    spxe.capture.running = 0;
+    pthread_cond_broadcast(&spxe.capture.cond);
+    pthread_mutex_unlock(&spxe.capture.mutex);
+    pthread_join(spxe.capture.thread, NULL);
+    spxeCaptureFree();
+}
+
+#else /* SPXE_CAPTURE */
+
+int spxeCaptureStart(const int fd, const int format, const double fps)
+{
+    (void)fd;
+    (void)format;
+    (void)fps;
+    fprintf(stderr, "spxe was compiled without SPXE_CAPTURE.\n");
+    return 0;
+}
+
+void spxeCaptureStop(void)
+{
+}
+
+#endif /* SPXE_CAPTURE */
+
+/* shared framebuffer export */
+
+#ifdef SPXE_SHARED
+
+static Px* spxeSharedSlot(const int i)
+{
+    spxeShared* const header = spxe.share.header;
+    return (Px*)((char*)header + header->offset + header->stride * i);
+}
+
+/* an odd sequence number tells readers the framebuffer is being written */
+
+static void spxeSharedBegin(const int i)
+{
+    long* const sequence = spxe.share.header->sequence + i;
+    spxeAtomicStore(sequence, *sequence + 1);
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+static void spxeSharedPublish(const int i)
+{
+    spxeShared* const header = spxe.share.header;
+    header->frames[i] = spxe.frame;
+    spxeAtomicStore(header->sequence + i, header->sequence[i] + 1);
+    spxeAtomicStore(&header->latest, (long)i);
+    spxeAtomicStore(&header->frame, spxe.frame);
+}
+
+#ifndef SPXE_THREADED
+
+static int spxeSharedNext(const int i, const int skip)
+{
+    const int next = (i + 1) % SPXE_SHARED_BUFFERS;
+    return next == skip ? (next + 1) % SPXE_SHARED_BUFFERS : next;
+}
+
+/* non threaded frames, published in place by spxePresent or copied */
+
+static void spxeSharedFrame(const Px* pixbuf)
+{
+    int i;
+    const size_t size = (size_t)spxe.scrres.width * spxe.scrres.height * spxePixelSize();
+    if (!spxe.share.header) {
+        return;
+    }
+
+    if (spxe.share.presenting && pixbuf == spxeSharedSlot(spxe.share.draw)) {
+        spxeSharedPublish(spxe.share.draw);
+        spxe.share.draw = spxeSharedNext(spxe.share.draw, -1);
+        spxeSharedBegin(spxe.share.draw);
+        return;
+    }
+
+    i = spxeSharedNext((int)spxe.share.header->latest, spxe.share.draw);
+    spxeSharedBegin(i);
+    memcpy(spxeSharedSlot(i), pixbuf, size);
+    spxeSharedPublish(i);
+}
+
+#endif /* SPXE_THREADED */
+
+static Px* spxeSharedOpen(const int width, const int height)
+{
+    int fd, i;
+    spxeShared* header;
+    const size_t offset = (sizeof(spxeShared) + 63) & ~(size_t)63;
+    const size_t stride = ((size_t)width * height * spxePixelSize() + 63) & ~(size_t)63;
+    const size_t size = offset + stride * SPXE_SHARED_BUFFERS;
+
+    fd = shm_open(spxe.share.name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "spxe could not open shared memory '%s'.\n", spxe.share.name);
+        return NULL;
+    }
+
+    /* truncating first clears a segment left over by a previous run */
+    if (ftruncate(fd, 0) || ftruncate(fd, (off_t)size)) {
+        fprintf(stderr, "spxe could not size shared memory '%s'.\n", spxe.share.name);
+        close(fd);
+        shm_unlink(spxe.share.name);
+        return NULL;
+    }
+
+    header = (spxeShared*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == (spxeShared*)MAP_FAILED) {
+        fprintf(stderr, "spxe could not map shared memory '%s'.\n", spxe.share.name);
+        shm_unlink(spxe.share.name);
+        return NULL;
+    }
+
+    header->version = 1;
+    header->width = width;
+    header->height = height;
+    header->format = spxe.pixel.format;
+    header->pixelsize = (int)spxePixelSize();
+    header->count = SPXE_SHARED_BUFFERS;
+    header->offset = (int)offset;
+    header->stride = (long)stride;
+    header->latest = -1;
+    header->frame = 0;
+    for (i = 0; i < SPXE_SHARED_BUFFERS; ++i) {
+        header->sequence[i] = 0;
+        header->frames[i] = 0;
+    }
+    memcpy(header->magic, "SPXS", 4);
+
+    spxe.share.header = header;
+    spxe.share.size = size;
+    spxe.share.draw = 0;
+    spxeSharedBegin(0);
+    return spxeSharedSlot(0);
+}
+
+static void spxeSharedClose(void)
+{
+    if (spxe.share.header) {
+        munmap((void*)spxe.share.header, spxe.share.size);
+        shm_unlink(spxe.share.name);
+        spxe.share.header = NULL;
+    }
 }
 
-int spxeMouseDown(const int button)
+int spxeShare(const char* name)
 {
-    return glfwGetMouseButton(spxe.window, button);
+    spxe.share.name = name;
+    return 1;
 }
 
-int spxeMousePressed(const int button)
+#else /* SPXE_SHARED */
+
+int spxeShare(const char* name)
 {
-    const int mouseButton = glfwGetMouseButton(spxe.window, button);
-    const int pressed = (mouseButton == GLFW_PRESS) && 
-                        (spxe.input.mouseState == GLFW_RELEASE);
-    spxe.input.mouseState = mouseButton;
-    return pressed;
+    (void)name;
+    fprintf(stderr, "spxe was compiled without SPXE_SHARED.\n");
+    return 0;
 }
 
-int spxeMouseReleased(const int button)
+#endif /* SPXE_SHARED */
+
+/* framebuffers from spxeStart are shared memory while exporting */
+
+static Px* spxeBufferAlloc(const int width, const int height)
 {
-    return !glfwGetMouseButton(spxe.window, button);
+#ifdef SPXE_SHARED
+    if (spxe.share.name) {
+        return spxeSharedOpen(width, height);
+    }
+#endif
+    return (Px*)calloc((size_t)width * height, spxePixelSize());
 }
 
-void spxeMouseVisible(const int visible)
+static void spxeBufferFree(Px* pixbuf)
 {
-    glfwSetInputMode(
-        spxe.window, GLFW_CURSOR, 
-        !visible ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL
-    );
+#ifdef SPXE_SHARED
+    if (spxe.share.header) {
+        return;
+    }
+#endif
+    free(pixbuf);
+}
+
+static int spxeSinkFrame(const Px* pixbuf)
+{
+#ifdef SPXE_CAPTURE
+    spxeCapturePush(pixbuf);
+#endif
+    if (spxe.sink.func) {
+        return spxe.sink.func(
+            pixbuf, spxe.scrres.width, spxe.scrres.height, spxe.sink.data
+        );
+    }
+    return 1;
+}
+
+/* dirty rectangles */
+
+void spxeDirtyTracking(const int enable)
+{
+#ifdef SPXE_THREADED
+    (void)enable;
+#else
+    spxe.dirty.enabled = enable;
+#endif
+    spxe.dirty.count = 0;
+    spxe.dirty.prevcount = 0;
+}
+
+void spxeDirtyRect(const int x, const int y, const int width, const int height)
+{
+    struct spxeRect r;
+    const int factor = spxe.super.factor;
+    if (!spxe.dirty.enabled) {
+        return;
+    }
+
+    /* regions of samples dirty every screen pixel they touch */
+    r.x0 = x / factor;
+    r.y0 = y / factor;
+    r.x1 = (x + width + factor - 1) / factor;
+    r.y1 = (y + height + factor - 1) / factor;
+    spxeDirtyAdd(r);
+}
+
+void spxeDirtyClear(Px* pixbuf, const Px px)
+{
+    int i, y;
+    const int factor = pixbuf == spxe.super.samples ? spxe.super.factor : 1;
+    const int width = spxe.scrres.width * factor;
+    const size_t bpp = spxePixelSize();
+    if (!spxe.dirty.enabled) {
+        spxePixelFill(pixbuf, (size_t)width * spxe.scrres.height * factor, px);
+        return;
+    }
+
+    for (i = 0; i < spxe.dirty.prevcount; ++i) {
+        const struct spxeRect r = spxe.dirty.prev[i];
+        for (y = r.y0 * factor; y < r.y1 * factor; ++y) {
+            spxePixelFill(
+                (char*)pixbuf + ((size_t)y * width + r.x0 * factor) * bpp, 
+                (size_t)(r.x1 - r.x0) * factor, px
+            );
+        }
+        spxeDirtyAdd(r);
+    }
+    spxe.dirty.prevcount = 0;
+}
+
+#ifdef SPXE_THREADED
+
+/* render thread */
+
+static void spxeRenderRescale(void)
+{
+    int i;
+    Px* buffers[3];
+    const size_t size = (size_t)spxe.thread.width * spxe.thread.height;
+    for (i = 0; i < 3; ++i) {
+        buffers[i] = (Px*)calloc(size, spxePixelSize());
+        if (!buffers[i]) {
+            while (i--) {
+                free(buffers[i]);
+            }
+            return;
+        }
+    }
+
+    for (i = 0; i < 3; ++i) {
+        free(spxe.thread.buffers[i]);
+        spxe.thread.buffers[i] = buffers[i];
+    }
+
+    spxe.scrres.width = spxe.thread.width;
+    spxe.scrres.height = spxe.thread.height;
+    spxeTextureResize(buffers[spxe.thread.present]);
+}
+
+static void* spxeRenderLoop(void* arg)
+{
+    int status, shots, x, y;
+    double t[5], stamp;
+    Px* pixbuf;
+    spxeLatchFunc latch;
+    void* data;
+
+    spxeCurrent = (struct spxeInfo*)arg;
+    glfwMakeContextCurrent(spxe.window);
+    pthread_mutex_lock(&spxe.thread.mutex);
+    while (1) {
+        while (spxe.thread.running && !spxe.thread.fresh && 
+               !spxe.thread.resized && !spxe.thread.rescaled) {
+            pthread_cond_wait(&spxe.thread.cond, &spxe.thread.mutex);
+        }
+
+        if (!spxe.thread.running) {
+            break;
+        }
+
+        /* apply state requested by the application thread */
+        if (spxe.thread.rescaled) {
+            spxeRenderRescale();
+            spxe.thread.rescaled = 0;
+            pthread_cond_broadcast(&spxe.thread.cond);
+        }
+        if (spxe.thread.resized) {
+#ifndef __APPLE__
+            glViewport(0, 0, spxe.winres.width, spxe.winres.height);
+#endif
+            spxeFrame();
+            spxe.thread.resized = 0;
+        }
+        if (spxe.thread.upload >= 0) {
+            spxeUploadInit(spxe.thread.upload);
+            spxe.thread.upload = -1;
+        }
+        if (spxe.thread.intervaled) {
+            spxeSwapApply();
+            spxe.thread.intervaled = 0;
+        }
+        if (spxe.thread.colored) {
+            const float n = 1.0F / 255.0F;
+            const Px c = spxe.thread.color;
+            glClearColor((float)c.r * n, (float)c.g * n, (float)c.b * n, (float)c.a * n);
+            spxe.thread.colored = 0;
+        }
+        if (spxe.thread.paletted) {
+            spxePaletteUpload();
+            spxe.thread.paletted = 0;
+        }
+        if (spxe.thread.fresh) {
+            const int ready = spxe.thread.ready;
+            spxe.thread.ready = spxe.thread.present;
+            spxe.thread.present = ready;
+            spxe.thread.fresh = 0;
+        }
+        
+        pixbuf = spxe.thread.buffers[spxe.thread.present];
+        stamp = spxe.thread.stamps[spxe.thread.present];
+        latch = spxe.latency.latch;
+        data = spxe.latency.data;
+        x = spxe.thread.latchx;
+        y = spxe.thread.latchy;
+        pthread_mutex_unlock(&spxe.thread.mutex);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (latch) {
+            latch(pixbuf, x, y, data);
+        }
+        t[0] = glfwGetTime();
+        spxeUpload(pixbuf);
+        t[1] = glfwGetTime();
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        pthread_mutex_lock(&spxe.thread.mutex);
+        spxeShotRead();
+        pthread_mutex_unlock(&spxe.thread.mutex);
+        t[2] = glfwGetTime();
+        status = spxeSinkFrame(pixbuf);
+        t[3] = glfwGetTime();
+        glfwSwapBuffers(spxe.window);
+        t[4] = glfwGetTime();
+        shots = spxeShotDeliver(0);
+
+        pthread_mutex_lock(&spxe.thread.mutex);
+        if (!status) {
+            spxe.sink.status = 0;
+        }
+        if (shots && spxe.redraw.ondemand) {
+            /* present again until the screenshots are read */
+            spxe.thread.resized = 1;
+        }
+        spxeLatencyRecord(stamp, t[4]);
+        if (spxe.stats.enabled) {
+            spxe.stats.current.upload = t[1] - t[0];
+            spxe.stats.current.draw = t[2] - t[1];
+            spxe.stats.current.sink = t[3] - t[2];
+            spxe.stats.current.swap = t[4] - t[3];
+            spxeStatsCommit();
+        }
+    }
+    pthread_mutex_unlock(&spxe.thread.mutex);
+
+    spxeShotFree();
+    spxeUploadFree();
+    glfwMakeContextCurrent(NULL);
+    return NULL;
+}
+
+static int spxeRenderThreadStart(const size_t scrsize)
+{
+    int i;
+    spxe.thread.draw = 0;
+    spxe.thread.ready = 1;
+    spxe.thread.present = 2;
+    spxe.thread.fresh = 0;
+    spxe.thread.resized = 0;
+    spxe.thread.upload = -1;
+    spxe.thread.colored = 0;
+    spxe.thread.intervaled = 0;
+    spxe.thread.paletted = 0;
+    spxe.thread.rescaled = 0;
+    spxe.thread.running = 1;
+
+    for (i = 0; i < 3; ++i) {
+#ifdef SPXE_SHARED
+        if (spxe.share.header) {
+            spxe.thread.buffers[i] = spxeSharedSlot(i);
+            continue;
+        }
+#endif
+        spxe.thread.buffers[i] = (Px*)calloc(scrsize, spxePixelSize());
+        if (!spxe.thread.buffers[i]) {
+            while (i--) {
+                free(spxe.thread.buffers[i]);
+            }
+            return 0;
+        }
+    }
+
+    pthread_mutex_init(&spxe.thread.mutex, NULL);
+    pthread_cond_init(&spxe.thread.cond, NULL);
+
+    /* hand the context over to the render thread */
+    glfwMakeContextCurrent(NULL);
+    if (pthread_create(&spxe.thread.thread, NULL, spxeRenderLoop, spxeCurrent)) {
+        glfwMakeContextCurrent(spxe.window);
+        pthread_mutex_destroy(&spxe.thread.mutex);
+        pthread_cond_destroy(&spxe.thread.cond);
+        for (i = 0; i < 3; ++i) {
+            spxeBufferFree(spxe.thread.buffers[i]);
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+static void spxeRenderThreadEnd(void)
+{
+    int i;
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.thread.running = 0;
+    pthread_cond_signal(&spxe.thread.cond);
+    pthread_mutex_unlock(&spxe.thread.mutex);
+    pthread_join(spxe.thread.thread, NULL);
+
+    pthread_mutex_destroy(&spxe.thread.mutex);
+    pthread_cond_destroy(&spxe.thread.cond);
+    for (i = 0; i < 3; ++i) {
+        spxeBufferFree(spxe.thread.buffers[i]);
+        spxe.thread.buffers[i] = NULL;
+    }
 }
 
+#endif /* SPXE_THREADED */
+
 /* spxe core */
 
+#ifdef SPXE_HEADLESS
+
+Px* spxeStart(          
+    const char* title,  const int winwidth, const int winheight, 
+    const int scrwidth, const int scrheight)
+{
+    Px* pixbuf;
+    (void)title;
+
+    /* allocate pixel framebuffer */
+    pixbuf = spxeBufferAlloc(scrwidth, scrheight);
+    if (!pixbuf) {
+        fprintf(stderr, "spxe failed to allocate pixel framebuffer.\n");
+        return NULL;
+    }
+
+    /* set global information */
+    spxe.winres.width = winwidth;
+    spxe.winres.height = winheight;
+    spxe.scrres.width = scrwidth;
+    spxe.scrres.height = scrheight;
+    spxe.scale.basewidth = scrwidth;
+    spxe.scale.baseheight = scrheight;
+    spxe.sink.status = 1;
+    spxe.frame = 0;
+    spxe.started = 1;
+
+    return spxeSuperStart(pixbuf);
+}
+
+void spxeBackgroundColor(const Px c)
+{
+    (void)c;
+}
+
+int spxeUploadMode(const int mode)
+{
+    (void)mode;
+    return SPXE_UPLOAD_DIRECT;
+}
+
+void spxeRender(const Px* pixbuf)
+{
+    double t;
+    pixbuf = spxeSuperFrame(pixbuf);
+    t = spxeClock();
+    if (!spxeSinkFrame(pixbuf)) {
+        spxe.sink.status = 0;
+    }
+    spxe.stats.current.sink = spxeClock() - t;
+#ifdef SPXE_SHARED
+    spxeSharedFrame(pixbuf);
+#endif
+    spxeDirtyFlush();
+}
+
+int spxeStep(void)
+{
+    int input;
+    const int status = spxe.sink.status;
+    spxe.sink.status = 1;
+    ++spxe.frame;
+    if (spxe.stats.enabled) {
+        spxeStatsCommit();
+    }
+    input = spxeInputFrame();
+    spxeScheduleUpdate();
+    return status && input;
+}
+
+#else /* SPXE_HEADLESS */
+
 Px* spxeStart(          
     const char* title,  const int winwidth, const int winheight, 
     const int scrwidth, const int scrheight)
 {
+    int i;
     Px* pixbuf;
     GLFWwindow* window;
-    unsigned int id, vao, ebo, texture;
+    unsigned int id, vao, ebo;
     unsigned int shader, vshader, fshader;
 
-    const size_t scrsize = scrwidth * scrheight;
     const unsigned int indices[] = {
         0,  1,  3,
         1,  2,  3 
@@ -528,16 +3756,24 @@ Px* spxeStart(
     window = glfwCreateWindow(winwidth, winheight, title, NULL, NULL);
     if (!window) {
         fprintf(stderr, "spxe failed to open glfw window.\n");
-        glfwTerminate();
+        if (!spxeWindowCount) {
+            glfwTerminate();
+        }
         return NULL;
     }
     
+    ++spxeWindowCount;
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+    spxeSwapApply();
 
     glfwSetWindowSizeLimits(window, scrwidth, scrheight, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    glfwSetWindowUserPointer(window, spxeCurrent);
     glfwSetWindowSizeCallback(window, spxeWindow);
+    glfwSetWindowRefreshCallback(window, spxeRefresh);
     glfwSetKeyCallback(window, spxeKeyboard);
+    glfwSetCharCallback(window, spxeText);
+    glfwSetMouseButtonCallback(window, spxeMouseButton);
+    glfwSetCursorPosCallback(window, spxeCursor);
     glfwSetInputMode(window, GLFW_MOD_CAPS_LOCK, GLFW_TRUE);
 
     /* OpenGL context and settings */
@@ -555,7 +3791,7 @@ Px* spxeStart(
     glDepthFunc(GL_LESS);
     
     /* allocate pixel framebuffer */
-    pixbuf = (Px*)calloc(scrsize, sizeof(Px));
+    pixbuf = spxeBufferAlloc(scrwidth, scrheight);
     if (!pixbuf) {
         fprintf(stderr, "spxe failed to allocate pixel framebuffer.\n");
         return NULL;
@@ -594,6 +3830,7 @@ Px* spxeStart(
 
     glGenBuffers(1, &vao);
     glBindBuffer(GL_ARRAY_BUFFER, vao);
+    spxeRatio();
     spxeFrame();
     
     glGenBuffers(1, &ebo);
@@ -604,47 +3841,341 @@ Px* spxeStart(
     glVertexAttribPointer(SPXE_SHADER_LAYOUT_LOCATION, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glBindBuffer(GL_ARRAY_BUFFER, vao);
 
+    /* compact formats are expanded by the fragment shader */
+    glUniform1i(glGetUniformLocation(shader, "tex"), 0);
+    glUniform1i(glGetUniformLocation(shader, "palette"), 1);
+    glUniform1i(glGetUniformLocation(shader, "format"), spxe.pixel.format);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (spxe.pixel.format == SPXE_FORMAT_INDEXED) {
+        if (!spxe.pixel.paletted) {
+            for (i = 0; i < 256; ++i) {
+                const unsigned char n = (unsigned char)i;
+                spxe.pixel.palette[i].r = n;
+                spxe.pixel.palette[i].g = n;
+                spxe.pixel.palette[i].b = n;
+                spxe.pixel.palette[i].a = 255;
+            }
+        }
+
+        glGenTextures(1, &spxe.upload.palette);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, spxe.upload.palette);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(
+            GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 
+            0, GL_RGBA, GL_UNSIGNED_BYTE, spxe.pixel.palette
+        );
+        glActiveTexture(GL_TEXTURE0);
+    }
+
     /* create render texture (framebuffer) */
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
-    glTexImage2D(
-        GL_TEXTURE_2D, 0, GL_RGBA, spxe.scrres.width, spxe.scrres.height, 
-        0, GL_RGBA, GL_UNSIGNED_BYTE, pixbuf
-    );
+    spxeTextureCreate(pixbuf);
+
+    spxe.scale.basewidth = scrwidth;
+    spxe.scale.baseheight = scrheight;
+    spxe.sink.status = 1;
+    spxe.frame = 0;
+    spxe.schedule.deadline = glfwGetTime();
+    spxe.schedule.last = spxe.schedule.deadline;
+    glfwGetCursorPos(window, &spxe.input.cursorx, &spxe.input.cursory);
+    spxeInputSnapshot();
+
+#ifdef SPXE_THREADED
+    spxeBufferFree(pixbuf);
+    if (!spxeRenderThreadStart((size_t)scrwidth * scrheight)) {
+        fprintf(stderr, "spxe failed to start render thread.\n");
+        return NULL;
+    }
+    pixbuf = spxe.thread.buffers[spxe.thread.draw];
+#endif
 
-    return pixbuf;
+    spxe.started = 1;
+    return spxeSuperStart(pixbuf);
 }
 
 void spxeBackgroundColor(const Px c)
 {
+#ifdef SPXE_THREADED
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.thread.color = c;
+    spxe.thread.colored = 1;
+    pthread_mutex_unlock(&spxe.thread.mutex);
+#else
     const float n = 1.0F / 255.0F;
     glClearColor((float)c.r * n, (float)c.g * n, (float)c.b * n, (float)c.a * n);
+#endif
+}
+
+int spxeUploadMode(const int mode)
+{
+    int m = mode;
+    if (m == SPXE_UPLOAD_PERSISTENT && !spxeBufferStorageSupported()) {
+        m = SPXE_UPLOAD_PBO;
+    }
+    if (m != SPXE_UPLOAD_PBO && m != SPXE_UPLOAD_PERSISTENT) {
+        m = SPXE_UPLOAD_DIRECT;
+    }
+#ifdef SPXE_THREADED
+    /* the render thread creates the buffers before its next frame */
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.thread.upload = m;
+    pthread_cond_signal(&spxe.thread.cond);
+    pthread_mutex_unlock(&spxe.thread.mutex);
+    return m;
+#else
+    return spxeUploadInit(m);
+#endif
+}
+
+#ifdef SPXE_THREADED
+
+/* frames from outside the ring are copied or downsampled into it */
+
+static void spxeRenderCopy(Px* buffer, const Px* pixbuf, const size_t size)
+{
+    struct spxeRect full;
+    if (spxe.super.factor == 1 || pixbuf != spxe.super.samples) {
+        memcpy(buffer, pixbuf, size);
+        return;
+    }
+
+    full.x0 = 0;
+    full.y0 = 0;
+    full.x1 = spxe.scrres.width;
+    full.y1 = spxe.scrres.height;
+    spxeSuperResolve(pixbuf, buffer, &full);
 }
 
 void spxeRender(const Px* pixbuf)
 {
-    glTexImage2D(
-        GL_TEXTURE_2D, 0, GL_RGBA, spxe.scrres.width, spxe.scrres.height, 
-        0, GL_RGBA, GL_UNSIGNED_BYTE, pixbuf
-    );
+    const size_t size = 
+        (size_t)spxe.scrres.width * spxe.scrres.height * spxePixelSize();
+    if (!spxeRedrawPending()) {
+        return;
+    }
+
+    spxeAtomicStore(&spxe.redraw.pending, 0);
+    pthread_mutex_lock(&spxe.thread.mutex);
+#ifdef SPXE_SHARED
+    if (spxe.share.header) {
+        spxeSharedBegin(spxe.thread.ready);
+        spxeRenderCopy(spxe.thread.buffers[spxe.thread.ready], pixbuf, size);
+        spxeSharedPublish(spxe.thread.ready);
+    } else
+#endif
+    spxeRenderCopy(spxe.thread.buffers[spxe.thread.ready], pixbuf, size);
+    spxe.thread.stamps[spxe.thread.ready] = spxe.latency.consumed;
+    spxe.thread.fresh = 1;
+    pthread_cond_signal(&spxe.thread.cond);
+    pthread_mutex_unlock(&spxe.thread.mutex);
+    spxeDirtyFlush();
+}
+
+int spxeStep(void)
+{
+    int status, input;
+    pthread_mutex_lock(&spxe.thread.mutex);
+    status = spxe.sink.status;
+    spxe.sink.status = 1;
+    pthread_mutex_unlock(&spxe.thread.mutex);
+    ++spxe.frame;
+    if (spxe.redraw.ondemand) {
+        spxeRedrawWait();
+    } else {
+        glfwPollEvents();
+        spxeThrottle();
+    }
+    input = spxeInputFrame();
+    spxeScheduleUpdate();
+    return status && input && !glfwWindowShouldClose(spxe.window);
+}
+
+/* the render thread reallocates the ring while the application waits */
+
+static Px* spxeRescale(Px* pixbuf, const int width, const int height)
+{
+    (void)pixbuf;
+    pthread_mutex_lock(&spxe.thread.mutex);
+    spxe.thread.width = width;
+    spxe.thread.height = height;
+    spxe.thread.rescaled = 1;
+    pthread_cond_signal(&spxe.thread.cond);
+    while (spxe.thread.rescaled && spxe.thread.running) {
+        pthread_cond_wait(&spxe.thread.cond, &spxe.thread.mutex);
+    }
+    pthread_mutex_unlock(&spxe.thread.mutex);
+    return spxe.thread.buffers[spxe.thread.draw];
+}
+
+int spxePresent(Px** pixbuf)
+{
+    int status, rescale, width = 0, height = 0;
+    const int draw = spxe.thread.draw;
+    if (*pixbuf != spxe.thread.buffers[draw]) {
+        spxeRender(*pixbuf);
+        return spxeStep();
+    }
+
+    rescale = spxeScaleUpdate(&width, &height);
+    if (spxeRedrawPending()) {
+        /* exchange the finished framebuffer for the free one */
+        spxeAtomicStore(&spxe.redraw.pending, 0);
+        pthread_mutex_lock(&spxe.thread.mutex);
+        spxe.thread.stamps[draw] = spxe.latency.consumed;
+#ifdef SPXE_SHARED
+        if (spxe.share.header) {
+            spxeSharedPublish(draw);
+            spxeSharedBegin(spxe.thread.ready);
+        }
+#endif
+        spxe.thread.draw = spxe.thread.ready;
+        spxe.thread.ready = draw;
+        spxe.thread.fresh = 1;
+        pthread_cond_signal(&spxe.thread.cond);
+        pthread_mutex_unlock(&spxe.thread.mutex);
+        *pixbuf = spxe.thread.buffers[spxe.thread.draw];
+    }
+
+    status = spxeStep();
+    if (status && rescale) {
+        *pixbuf = spxeRescale(*pixbuf, width, height);
+    }
+    spxe.scale.returned = spxeClock();
+    return status;
+}
+
+#else /* SPXE_THREADED */
+
+void spxeRender(const Px* pixbuf)
+{
+    double t[4];
+    if (!spxeRedrawPending()) {
+        return;
+    }
 
+    spxeAtomicStore(&spxe.redraw.pending, 0);
+    spxe.redraw.presented = 1;
+    pixbuf = spxeSuperFrame(pixbuf);
+    if (spxe.latency.latch) {
+        int x, y;
+        double cx, cy;
+        glfwGetCursorPos(spxe.window, &cx, &cy);
+        spxeCursorScreen(cx, cy, &x, &y);
+        spxe.latency.latch((Px*)pixbuf, x, y, spxe.latency.data);
+    }
+    t[0] = glfwGetTime();
+    spxeUpload(pixbuf);
+    t[1] = glfwGetTime();
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    spxeShotRead();
+    t[2] = glfwGetTime();
+    if (!spxeSinkFrame(pixbuf)) {
+        spxe.sink.status = 0;
+    }
+#ifdef SPXE_SHARED
+    spxeSharedFrame(pixbuf);
+#endif
+    t[3] = glfwGetTime();
+    spxe.stats.current.upload = t[1] - t[0];
+    spxe.stats.current.draw = t[2] - t[1];
+    spxe.stats.current.sink = t[3] - t[2];
+    spxeDirtyFlush();
 }
 
 int spxeStep(void)
 { 
-    glfwPollEvents();
-    glfwSwapBuffers(spxe.window);
-    glClear(GL_COLOR_BUFFER_BIT);
-    return !glfwWindowShouldClose(spxe.window);
+    int input;
+    double t[3];
+    const int status = spxe.sink.status;
+    spxe.sink.status = 1;
+    ++spxe.frame;
+    if (spxeShotDeliver(0) && spxe.redraw.ondemand) {
+        /* draw again until the screenshots are read */
+        spxeAtomicStore(&spxe.redraw.pending, 1);
+    }
+    if (spxe.redraw.ondemand) {
+        /* swap presented frames only, then sleep until something happens */
+        if (spxe.redraw.presented) {
+            t[0] = glfwGetTime();
+            glfwSwapBuffers(spxe.window);
+            glClear(GL_COLOR_BUFFER_BIT);
+            t[1] = glfwGetTime();
+            spxeLatencyRecord(spxe.latency.consumed, t[1]);
+            if (spxe.stats.enabled) {
+                spxe.stats.current.swap = t[1] - t[0];
+                spxeStatsCommit();
+            }
+            spxe.redraw.presented = 0;
+        }
+        spxeRedrawWait();
+    } else {
+        t[0] = glfwGetTime();
+        glfwPollEvents();
+        t[1] = glfwGetTime();
+        glfwSwapBuffers(spxe.window);
+        glClear(GL_COLOR_BUFFER_BIT);
+        t[2] = glfwGetTime();
+        spxeLatencyRecord(spxe.latency.consumed, t[2]);
+        if (spxe.stats.enabled) {
+            spxe.stats.current.poll = t[1] - t[0];
+            spxe.stats.current.swap = t[2] - t[1];
+            spxeStatsCommit();
+        }
+        spxeThrottle();
+    }
+    input = spxeInputFrame();
+    spxeScheduleUpdate();
+    return status && input && !glfwWindowShouldClose(spxe.window);
+}
+
+#endif /* SPXE_THREADED */
+#endif /* SPXE_HEADLESS */
+
+#ifndef SPXE_THREADED
+
+static Px* spxeRescale(Px* pixbuf, const int width, const int height)
+{
+    Px* resized = (Px*)calloc((size_t)width * height, spxePixelSize());
+    if (!resized) {
+        return pixbuf;
+    }
+
+    free(pixbuf);
+    spxe.scrres.width = width;
+    spxe.scrres.height = height;
+    spxe.dirty.count = 0;
+    spxe.dirty.prevcount = 0;
+#ifndef SPXE_HEADLESS
+    spxeTextureResize(resized);
+#endif
+    return resized;
+}
+
+int spxePresent(Px** pixbuf)
+{
+    int status, width = 0, height = 0;
+    const int rescale = spxeScaleUpdate(&width, &height);
+#ifdef SPXE_SHARED
+    /* the published framebuffer is exchanged for the next of the ring */
+    if (spxe.share.header && *pixbuf == spxeSharedSlot(spxe.share.draw)) {
+        spxe.share.presenting = 1;
+        status = spxeRun(*pixbuf);
+        spxe.share.presenting = 0;
+        *pixbuf = spxeSharedSlot(spxe.share.draw);
+    } else
+#endif
+    status = spxeRun(*pixbuf);
+    if (status && rescale) {
+        *pixbuf = spxeRescale(*pixbuf, width, height);
+    }
+    spxe.scale.returned = spxeClock();
+    return status;
 }
 
+#endif /* SPXE_THREADED */
+
 int spxeRun(const Px* pixbuf)
 {
     spxeRender(pixbuf);
@@ -653,13 +4184,58 @@ int spxeRun(const Px* pixbuf)
 
 int spxeEnd(Px* pixbuf)
 {
-    glfwTerminate();
+    if (spxe.super.samples) {
+        if (pixbuf == spxe.super.samples) {
+            pixbuf = spxe.super.resolved;
+        }
+        free(spxe.super.samples);
+        free(spxe.super.accum);
+        spxe.super.samples = NULL;
+        spxe.super.accum = NULL;
+        spxe.super.resolved = NULL;
+    }
+
+    if (spxe.stats.dump) {
+        spxeStatsWrite(spxe.stats.dump);
+    }
+
+    spxeCaptureStop();
+    spxeRecordStop();
+
+#ifdef SPXE_THREADED
+    if (spxe.window) {
+        spxeRenderThreadEnd();
+    }
+#elif !defined SPXE_HEADLESS
+    if (spxe.window) {
+        glfwMakeContextCurrent(spxe.window);
+        spxeShotFree();
+        spxeUploadFree();
+    }
+#endif
+
+#ifndef SPXE_HEADLESS
+    if (spxe.window) {
+        glfwDestroyWindow(spxe.window);
+        spxe.window = NULL;
+        --spxeWindowCount;
+    }
+    if (!spxeWindowCount) {
+        glfwTerminate();
+    }
+#endif
+
+#ifndef SPXE_THREADED
     if (pixbuf) {
-        free(pixbuf);
-        return EXIT_SUCCESS;
+        spxeBufferFree(pixbuf);
     }
+#endif
+#ifdef SPXE_SHARED
+    spxeSharedClose();
+#endif
 
-    return EXIT_FAILURE;
+    spxe.started = 0;
+    return pixbuf ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 #endif /* SPXE_APPLICATION */
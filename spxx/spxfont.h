@@ -120,6 +120,179 @@ int     spxFontDrawText(Tex2D texture, const Font2D*, const char*, ivec2, const
 #define SPXF_DEFAULT_FONT_HEIGHT 6
 #define SPXF_DEFAULT_FONT_WIDTH 6
 
+/* shared by spxplot and spxfont, whichever is implemented first defines it */
+
+#ifndef SPX_BLEND_DEFINED
+#define SPX_BLEND_DEFINED
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SPX_BLEND_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPX_BLEND_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPX_BLEND_NEON
+#endif
+
+/* fixed point blending, weights in 0-255 and a rounded divide by 255 */
+
+static uint8_t mix8(const uint8_t a, const uint8_t b, const unsigned int w)
+{
+    const unsigned int t = a * (255 - w) + b * w + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+#if defined(SPX_BLEND_AVX2)
+
+static __m256i pxBlend8(const __m256i dst, const __m256i weight, const __m256i color)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(255), half = _mm256_set1_epi16(128);
+    __m256i w, lo, hi;
+    
+    w = _mm256_unpacklo_epi8(weight, zero);
+    lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(max, w)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(color, zero), w)
+    );
+    w = _mm256_unpackhi_epi8(weight, zero);
+    hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(max, w)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(color, zero), w)
+    );
+    
+    lo = _mm256_add_epi16(lo, half);
+    hi = _mm256_add_epi16(hi, half);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+#elif defined(SPX_BLEND_SSE2)
+
+static __m128i pxBlend4(const __m128i dst, const __m128i weight, const __m128i color)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255), half = _mm_set1_epi16(128);
+    __m128i w, lo, hi;
+    
+    w = _mm_unpacklo_epi8(weight, zero);
+    lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_sub_epi16(max, w)),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), w)
+    );
+    w = _mm_unpackhi_epi8(weight, zero);
+    hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_sub_epi16(max, w)),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), w)
+    );
+    
+    lo = _mm_add_epi16(lo, half);
+    hi = _mm_add_epi16(hi, half);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+#elif defined(SPX_BLEND_NEON)
+
+static uint8x8_t pxBlendNEON(const uint8x8_t dst, const uint8x8_t w, const uint8_t color)
+{
+    uint16x8_t t = vmlal_u8(vmull_u8(dst, vmvn_u8(w)), vdup_n_u8(color), w);
+    t = vaddq_u16(t, vdupq_n_u16(128));
+    return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+#endif
+
+/* blends a span towards color by a constant weight or a coverage mask */
+
+static void pxBlendRun(
+    Px* span, const uint8_t* mask, const uint8_t weight, 
+    const size_t count, const Px color)
+{
+    size_t i = 0;
+    union { Px px; uint32_t word; } fill;
+    fill.px = color;
+
+#if defined(SPX_BLEND_AVX2)
+    {
+        const __m256i c = _mm256_set1_epi32((int)fill.word);
+        const __m256i spread = _mm256_set1_epi32(0x01010101);
+        const __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi8(-1);
+        for (; i + 8 <= count; i += 8) {
+            __m256i w, d;
+            if (mask) {
+                /* skip empty runs and fill covered ones, common in glyphs */
+                const __m128i m = _mm_loadl_epi64((const __m128i*)(const void*)(mask + i));
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) & 0xFF) == 0xFF) {
+                    continue;
+                }
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, full)) & 0xFF) == 0xFF) {
+                    _mm256_storeu_si256((__m256i*)(void*)(span + i), c);
+                    continue;
+                }
+                w = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(m), spread);
+            } else {
+                w = _mm256_set1_epi8((char)weight);
+            }
+            d = _mm256_loadu_si256((const __m256i*)(const void*)(span + i));
+            _mm256_storeu_si256((__m256i*)(void*)(span + i), pxBlend8(d, w, c));
+        }
+    }
+#elif defined(SPX_BLEND_SSE2)
+    {
+        const __m128i c = _mm_set1_epi32((int)fill.word);
+        for (; i + 4 <= count; i += 4) {
+            __m128i w, d;
+            if (mask) {
+                const uint32_t m = (uint32_t)mask[i] | (uint32_t)mask[i + 1] << 8 | 
+                    (uint32_t)mask[i + 2] << 16 | (uint32_t)mask[i + 3] << 24;
+                if (m == 0) {
+                    continue;
+                }
+                if (m == 0xFFFFFFFF) {
+                    _mm_storeu_si128((__m128i*)(void*)(span + i), c);
+                    continue;
+                }
+                w = _mm_cvtsi32_si128((int)m);
+                w = _mm_unpacklo_epi8(w, w);
+                w = _mm_unpacklo_epi16(w, w);
+            } else {
+                w = _mm_set1_epi8((char)weight);
+            }
+            d = _mm_loadu_si128((const __m128i*)(const void*)(span + i));
+            _mm_storeu_si128((__m128i*)(void*)(span + i), pxBlend4(d, w, c));
+        }
+    }
+#elif defined(SPX_BLEND_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t d;
+        const uint8x8_t w = mask ? vld1_u8(mask + i) : vdup_n_u8(weight);
+        d = vld4_u8((const uint8_t*)(const void*)(span + i));
+        d.val[0] = pxBlendNEON(d.val[0], w, color.r);
+        d.val[1] = pxBlendNEON(d.val[1], w, color.g);
+        d.val[2] = pxBlendNEON(d.val[2], w, color.b);
+        d.val[3] = pxBlendNEON(d.val[3], w, color.a);
+        vst4_u8((uint8_t*)(void*)(span + i), d);
+    }
+#else
+    (void)fill;
+#endif
+
+    for (; i < count; ++i) {
+        const unsigned int w = mask ? mask[i] : weight;
+        span[i].r = mix8(span[i].r, color.r, w);
+        span[i].g = mix8(span[i].g, color.g, w);
+        span[i].b = mix8(span[i].b, color.b, w);
+        span[i].a = mix8(span[i].a, color.a, w);
+    }
+}
+
+#endif /* SPX_BLEND_DEFINED */
+
 static unsigned char 
 spxPixmaps[SPXF_GLYPH_COUNT][SPXF_DEFAULT_FONT_HEIGHT * SPXF_DEFAULT_FONT_WIDTH] = {
     ['a'] = {
@@ -656,35 +829,34 @@ Font2D spxFontLoad(const char* path)
 
 #endif /* SPXF_NO_FREETYPE */
 
-static uint8_t lerpu8(uint8_t a, uint8_t b, float t)
-{
-    return (uint8_t)((float)a + t * (float)(b - a));
-}
+/* glyph rows share the spxplot blend kernel */
 
-static Px spxFontPlot(Px a, Px b, float t)
+static void spxFontPlot(Px* span, const uint8_t* mask, const size_t count, const Px color)
 {
-    Px px;
-    px.r = lerpu8(a.r, b.r, t);
-    px.g = lerpu8(a.g, b.g, t);
-    px.b = lerpu8(a.b, b.b, t);
-    px.a = lerpu8(a.a, b.a, t);
-    return px;
+    pxBlendRun(span, mask, 0, count, color);
 }
 
 int spxFontDrawGlyph(Tex2D texture, const Glyph glyph, ivec2 p, const Px color)
 {
-    int x, y, ret = 0;
-    const int resx = texture.width - 1, resy = texture.height - 1;
+    int y, ret;
     const int endx = p.x + glyph.size.x, endy = p.y + glyph.size.y;
+    const int startx = p.x < 0 ? 0 : p.x, starty = p.y < 0 ? 0 : p.y;
+    const int clipx = endx < texture.width ? endx : texture.width;
+    const int clipy = endy < texture.height ? endy : texture.height;
+    const int overx = endx - (startx > texture.width ? startx : texture.width);
+    const int overy = endy - (starty > texture.height ? starty : texture.height);
+    
+    /* one per row and column of the glyph that falls off the texture */
     ret = p.y < 0 || p.x < 0;
-    for (y = p.y; y < endy; ++y) {
-        ret += y > resy;
-        for (x = p.x; x < endx; ++x) {
-            Px* px = texture.pixbuf + y * texture.width + x;
-            int index = (glyph.size.y - 1 - (y - p.y)) * glyph.size.x + (x - p.x);
-            *px = spxFontPlot(*px, color, (float)glyph.pixmap[index] / 255.0F);
-            ret += x > resx;
-        }
+    ret += overy > 0 ? overy : 0;
+    ret += overx > 0 ? overx * glyph.size.y : 0;
+
+    for (y = starty; startx < clipx && y < clipy; ++y) {
+        const int index = (glyph.size.y - 1 - (y - p.y)) * glyph.size.x + (startx - p.x);
+        spxFontPlot(
+            texture.pixbuf + y * texture.width + startx, 
+            glyph.pixmap + index, (size_t)(clipx - startx), color
+        );
     }
     return ret;
 }
@@ -44,6 +44,7 @@ and algorithms to easily create your own images.
 
 /* Pixel Plotter */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifndef PX_TYPE_DEFINED
@@ -105,14 +106,30 @@ typedef struct Vert2D {
 #define pxInside(tex, px, py) ((px) >= 0 && (px) < tex.width &&\
                                 (py) >= 0 && (py) < tex.height)
 
+#define SPXP_JOIN_MITER 0
+#define SPXP_JOIN_ROUND 1
+#define SPXP_JOIN_BEVEL 2
+
+#define SPXP_FILL_NONZERO 0
+#define SPXP_FILL_EVENODD 1
+
+typedef void (*pxDirtyFunc)(const Tex2D texture, int x, int y, int width, int height);
+
+void    pxDirtyCallback(pxDirtyFunc callback);
+
 Px      pxLerp(Px a, Px b, float t);
 Px      pxTexMap(const Tex2D texture, vec2 uv);
 Px      pxTexMapBilinear(const Tex2D texture, vec2 uv);
 void    pxPlot(const Tex2D texture, int x, int y, Px color);
+void    pxClear(const Tex2D texture, const Px color);
 void    pxMix(const Tex2D texture, int x, int y, Px color);
 void    pxBlend(const Tex2D texture, int x, int y, float t, Px color);
+void    pxBlendSpan(Px* span, size_t count, uint8_t weight, const Px color);
+void    pxBlendMask(Px* span, const uint8_t* mask, size_t count, const Px color);
 void    pxPlotLine(const Tex2D texture, ivec2 p, ivec2 q, const Px color);
 void    pxPlotLineSmooth(const Tex2D texture, vec2 p, vec2 q, const Px color);
+void    pxPlotLineWide(const Tex2D texture, vec2 p, vec2 q, float width, const Px color);
+void    pxPlotPolyline(const Tex2D texture, const vec2* p, int count, float width, int join, const Px c);
 void    pxPlotBezier2(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col);
 void    pxPlotBezier2Smooth(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col);
 void    pxPlotBezier3(const Tex2D texture, vec2 a, vec2 b, vec2 c, vec2 d, const Px col);
@@ -121,8 +138,14 @@ void    pxPlotRectRound(const Tex2D texture, ivec2 p, ivec2 q, float t, const Px
 void    pxPlotTri(const Tex2D texture, ivec2 p0, ivec2 p1, ivec2 p2, const Px color);
 void    pxPlotTriSmooth(const Tex2D texture, vec2 p0, vec2 p1, vec2 p2, const Px c);
 void    pxPlotTriTex(const Tex2D fb, const Tex2D tex, Vert2D p0, Vert2D p1, Vert2D p2);
+void    pxPlotPolygon(const Tex2D texture, const vec2* p, int count, int rule, const Px color);
+void    pxPlotPath(const Tex2D texture, const vec2* p, const int* counts, int n, int rule, const Px c);
 void    pxPlotCircle(const Tex2D texture, ivec2 p, float r, const Px color);
 void    pxPlotCircleSmooth(const Tex2D texture, ivec2 p, float r, const Px color);
+void    pxPlotEllipse(const Tex2D texture, ivec2 p, vec2 r, const Px color);
+void    pxPlotEllipseSmooth(const Tex2D texture, ivec2 p, vec2 r, const Px color);
+void    pxPlotRing(const Tex2D texture, ivec2 p, float r0, float r1, const Px color);
+void    pxPlotRingSmooth(const Tex2D texture, ivec2 p, float r0, float r1, const Px color);
 void    pxPlotTexture(const Tex2D fb, const Tex2D texture, ivec2 p);
 void    pxPlotTextureCentered(const Tex2D fb, const Tex2D texture, ivec2 p);
 
@@ -135,37 +158,336 @@ void    pxPlotTextureCentered(const Tex2D fb, const Tex2D texture, ivec2 p);
 *   IMPLEMENTATION   *
 *********************/
 
-#ifndef SPXP_SUBSAMPLES 
-#define SPXP_SUBSAMPLES 2
-#endif /* SPXP_SUBSAMPLES */
+#ifndef SPXP_SPAN_MAX
+#define SPXP_SPAN_MAX 256
+#endif /* SPXP_SPAN_MAX */
+
+#ifndef SPXP_TRI_BLOCK
+#define SPXP_TRI_BLOCK 8
+#endif /* SPXP_TRI_BLOCK */
+
+#ifndef SPXP_MITER_LIMIT
+#define SPXP_MITER_LIMIT 4.0F
+#endif /* SPXP_MITER_LIMIT */
+
+#ifndef SPXP_CLIP_DEPTH
+#define SPXP_CLIP_DEPTH 16
+#endif /* SPXP_CLIP_DEPTH */
+
+#ifndef SPXP_CURVE_TOLERANCE
+#define SPXP_CURVE_TOLERANCE 0.25F
+#endif /* SPXP_CURVE_TOLERANCE */
+
+#ifndef SPXP_CURVE_POINTS
+#define SPXP_CURVE_POINTS 256
+#endif /* SPXP_CURVE_POINTS */
+
+#ifndef SPXP_FILL_ROWS
+#define SPXP_FILL_ROWS 16
+#endif /* SPXP_FILL_ROWS */
 
 #include <math.h>
 
-/* plotting functions */
+/* shared by spxplot and spxfont, whichever is implemented first defines it */
+
+#ifndef SPX_BLEND_DEFINED
+#define SPX_BLEND_DEFINED
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SPX_BLEND_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPX_BLEND_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPX_BLEND_NEON
+#endif
+
+/* fixed point blending, weights in 0-255 and a rounded divide by 255 */
+
+static uint8_t mix8(const uint8_t a, const uint8_t b, const unsigned int w)
+{
+    const unsigned int t = a * (255 - w) + b * w + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+#if defined(SPX_BLEND_AVX2)
 
-static uint8_t mix8(uint8_t a, uint8_t b, float t)
+static __m256i pxBlend8(const __m256i dst, const __m256i weight, const __m256i color)
 {
-    return (uint8_t)((float)a + t * (float)(b - a));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(255), half = _mm256_set1_epi16(128);
+    __m256i w, lo, hi;
+    
+    w = _mm256_unpacklo_epi8(weight, zero);
+    lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(max, w)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(color, zero), w)
+    );
+    w = _mm256_unpackhi_epi8(weight, zero);
+    hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(max, w)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(color, zero), w)
+    );
+    
+    lo = _mm256_add_epi16(lo, half);
+    hi = _mm256_add_epi16(hi, half);
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+    return _mm256_packus_epi16(lo, hi);
 }
 
-static float normalize(float min, float max, float n)
+#elif defined(SPX_BLEND_SSE2)
+
+static __m128i pxBlend4(const __m128i dst, const __m128i weight, const __m128i color)
 {
-    return max - min == 0.0F ? 0.0F : (n - min) / (max - min);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255), half = _mm_set1_epi16(128);
+    __m128i w, lo, hi;
+    
+    w = _mm_unpacklo_epi8(weight, zero);
+    lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_sub_epi16(max, w)),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), w)
+    );
+    w = _mm_unpackhi_epi8(weight, zero);
+    hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_sub_epi16(max, w)),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), w)
+    );
+    
+    lo = _mm_add_epi16(lo, half);
+    hi = _mm_add_epi16(hi, half);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    return _mm_packus_epi16(lo, hi);
 }
 
-static vec2 vec2_mix(vec2 a, vec2 b, float t)
+#elif defined(SPX_BLEND_NEON)
+
+static uint8x8_t pxBlendNEON(const uint8x8_t dst, const uint8x8_t w, const uint8_t color)
 {
-    vec2 p;
-    p.x = a.x + t * (b.x - a.x);
-    p.y = a.y + t * (b.y - a.y);
-    return p;
+    uint16x8_t t = vmlal_u8(vmull_u8(dst, vmvn_u8(w)), vdup_n_u8(color), w);
+    t = vaddq_u16(t, vdupq_n_u16(128));
+    return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+#endif
+
+/* blends a span towards color by a constant weight or a coverage mask */
+
+static void pxBlendRun(
+    Px* span, const uint8_t* mask, const uint8_t weight, 
+    const size_t count, const Px color)
+{
+    size_t i = 0;
+    union { Px px; uint32_t word; } fill;
+    fill.px = color;
+
+#if defined(SPX_BLEND_AVX2)
+    {
+        const __m256i c = _mm256_set1_epi32((int)fill.word);
+        const __m256i spread = _mm256_set1_epi32(0x01010101);
+        const __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi8(-1);
+        for (; i + 8 <= count; i += 8) {
+            __m256i w, d;
+            if (mask) {
+                /* skip empty runs and fill covered ones, common in glyphs */
+                const __m128i m = _mm_loadl_epi64((const __m128i*)(const void*)(mask + i));
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) & 0xFF) == 0xFF) {
+                    continue;
+                }
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, full)) & 0xFF) == 0xFF) {
+                    _mm256_storeu_si256((__m256i*)(void*)(span + i), c);
+                    continue;
+                }
+                w = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(m), spread);
+            } else {
+                w = _mm256_set1_epi8((char)weight);
+            }
+            d = _mm256_loadu_si256((const __m256i*)(const void*)(span + i));
+            _mm256_storeu_si256((__m256i*)(void*)(span + i), pxBlend8(d, w, c));
+        }
+    }
+#elif defined(SPX_BLEND_SSE2)
+    {
+        const __m128i c = _mm_set1_epi32((int)fill.word);
+        for (; i + 4 <= count; i += 4) {
+            __m128i w, d;
+            if (mask) {
+                const uint32_t m = (uint32_t)mask[i] | (uint32_t)mask[i + 1] << 8 | 
+                    (uint32_t)mask[i + 2] << 16 | (uint32_t)mask[i + 3] << 24;
+                if (m == 0) {
+                    continue;
+                }
+                if (m == 0xFFFFFFFF) {
+                    _mm_storeu_si128((__m128i*)(void*)(span + i), c);
+                    continue;
+                }
+                w = _mm_cvtsi32_si128((int)m);
+                w = _mm_unpacklo_epi8(w, w);
+                w = _mm_unpacklo_epi16(w, w);
+            } else {
+                w = _mm_set1_epi8((char)weight);
+            }
+            d = _mm_loadu_si128((const __m128i*)(const void*)(span + i));
+            _mm_storeu_si128((__m128i*)(void*)(span + i), pxBlend4(d, w, c));
+        }
+    }
+#elif defined(SPX_BLEND_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t d;
+        const uint8x8_t w = mask ? vld1_u8(mask + i) : vdup_n_u8(weight);
+        d = vld4_u8((const uint8_t*)(const void*)(span + i));
+        d.val[0] = pxBlendNEON(d.val[0], w, color.r);
+        d.val[1] = pxBlendNEON(d.val[1], w, color.g);
+        d.val[2] = pxBlendNEON(d.val[2], w, color.b);
+        d.val[3] = pxBlendNEON(d.val[3], w, color.a);
+        vst4_u8((uint8_t*)(void*)(span + i), d);
+    }
+#else
+    (void)fill;
+#endif
+
+    for (; i < count; ++i) {
+        const unsigned int w = mask ? mask[i] : weight;
+        span[i].r = mix8(span[i].r, color.r, w);
+        span[i].g = mix8(span[i].g, color.g, w);
+        span[i].b = mix8(span[i].b, color.b, w);
+        span[i].a = mix8(span[i].a, color.a, w);
+    }
+}
+
+#endif /* SPX_BLEND_DEFINED */
+
+/* dirty region reporting */
+
+static pxDirtyFunc pxDirty = NULL;
+
+void pxDirtyCallback(pxDirtyFunc callback)
+{
+    pxDirty = callback;
+}
+
+static void pxDirtyBounds(const Tex2D texture, int x0, int y0, int x1, int y1)
+{
+    if (!pxDirty) {
+        return;
+    }
+    
+    if (x1 < x0) {
+        pxSwap(x0, x1, int);
+    }
+    if (y1 < y0) {
+        pxSwap(y0, y1, int);
+    }
+
+    x0 = pxMax(x0, 0);
+    y0 = pxMax(y0, 0);
+    x1 = pxMin(x1, texture.width - 1);
+    y1 = pxMin(y1, texture.height - 1);
+    if (x0 <= x1 && y0 <= y1) {
+        pxDirty(texture, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+    }
 }
 
-static vec2 vec2_floor(vec2 a)
+static void pxDirtyHull(const Tex2D texture, const vec2* p, const int count)
+{
+    int i;
+    float minx = p[0].x, miny = p[0].y, maxx = p[0].x, maxy = p[0].y;
+    if (!pxDirty) {
+        return;
+    }
+
+    for (i = 1; i < count; ++i) {
+        minx = pxMin(minx, p[i].x);
+        miny = pxMin(miny, p[i].y);
+        maxx = pxMax(maxx, p[i].x);
+        maxy = pxMax(maxy, p[i].y);
+    }
+    
+    pxDirtyBounds(
+        texture, (int)floor(minx) - 1, (int)floor(miny) - 1, 
+        (int)floor(maxx) + 1, (int)floor(maxy) + 1
+    );
+}
+
+/* solid span fill, aligned vector stores with scalar head and tail */
+
+static void pxFillSpan(Px* dst, const size_t count, const Px color)
+{
+    size_t i = 0;
+    union { Px px; uint32_t word; } fill;
+    fill.px = color;
+
+#if defined(SPX_BLEND_AVX2)
+    for (; i < count && ((size_t)(dst + i) & 31); ++i) {
+        dst[i] = color;
+    }
+    {
+        const __m256i v = _mm256_set1_epi32((int)fill.word);
+        for (; i + 16 <= count; i += 16) {
+            _mm256_store_si256((__m256i*)(void*)(dst + i), v);
+            _mm256_store_si256((__m256i*)(void*)(dst + i + 8), v);
+        }
+        for (; i + 8 <= count; i += 8) {
+            _mm256_store_si256((__m256i*)(void*)(dst + i), v);
+        }
+    }
+#elif defined(SPX_BLEND_SSE2)
+    for (; i < count && ((size_t)(dst + i) & 15); ++i) {
+        dst[i] = color;
+    }
+    {
+        const __m128i v = _mm_set1_epi32((int)fill.word);
+        for (; i + 8 <= count; i += 8) {
+            _mm_store_si128((__m128i*)(void*)(dst + i), v);
+            _mm_store_si128((__m128i*)(void*)(dst + i + 4), v);
+        }
+        for (; i + 4 <= count; i += 4) {
+            _mm_store_si128((__m128i*)(void*)(dst + i), v);
+        }
+    }
+#elif defined(SPX_BLEND_NEON)
+    {
+        const uint32x4_t v = vdupq_n_u32(fill.word);
+        for (; i + 8 <= count; i += 8) {
+            vst1q_u32((uint32_t*)(void*)(dst + i), v);
+            vst1q_u32((uint32_t*)(void*)(dst + i + 4), v);
+        }
+    }
+#else
+    (void)fill;
+#endif
+
+    for (; i < count; ++i) {
+        dst[i] = color;
+    }
+}
+
+static unsigned int pxWeight(const float t)
+{
+    return t <= 0.0F ? 0 : t >= 1.0F ? 255 : (unsigned int)(t * 255.0F + 0.5F);
+}
+
+void pxBlendSpan(Px* span, const size_t count, const uint8_t weight, const Px color)
+{
+    pxBlendRun(span, NULL, weight, count, color);
+}
+
+void pxBlendMask(Px* span, const uint8_t* mask, const size_t count, const Px color)
+{
+    pxBlendRun(span, mask, 0, count, color);
+}
+
+/* plotting functions */
+
+static vec2 vec2_mix(vec2 a, vec2 b, float t)
 {
     vec2 p;
-    p.x = floor(a.x);
-    p.y = floor(a.y);
+    p.x = a.x + t * (b.x - a.x);
+    p.y = a.y + t * (b.y - a.y);
     return p;
 }
 
@@ -177,10 +499,11 @@ static float vec2_determinant(vec2 a, vec2 b, vec2 c)
 Px pxLerp(Px a, Px b, float t)
 {
     Px px;
-    px.r = mix8(a.r, b.r, t);
-    px.g = mix8(a.g, b.g, t);
-    px.b = mix8(a.b, b.b, t);
-    px.a = mix8(a.a, b.a, t);
+    const unsigned int w = pxWeight(t);
+    px.r = mix8(a.r, b.r, w);
+    px.g = mix8(a.g, b.g, w);
+    px.b = mix8(a.b, b.b, w);
+    px.a = mix8(a.a, b.a, w);
     return px;
 }
 
@@ -191,6 +514,12 @@ void pxPlot(const Tex2D texture, int x, int y, Px color)
     }
 }
 
+void pxClear(const Tex2D texture, const Px color)
+{
+    pxDirtyBounds(texture, 0, 0, texture.width - 1, texture.height - 1);
+    pxFillSpan(texture.pixbuf, (size_t)texture.width * texture.height, color);
+}
+
 void pxBlend(const Tex2D texture, int x, int y, float t, Px color)
 {
     if (x >= 0 && x < texture.width && y >= 0 && y < texture.height) {
@@ -200,45 +529,170 @@ void pxBlend(const Tex2D texture, int x, int y, float t, Px color)
 
 void pxMix(const Tex2D texture, int x, int y, Px color)
 {
-    float t = (float)color.a / 255.0F;
-    color.a = 255;
-    pxBlend(texture, x, y, t, color);
+    const uint8_t w = color.a;
+    if (x >= 0 && x < texture.width && y >= 0 && y < texture.height) {
+        color.a = 255;
+        pxBlendRun(&pxAt(texture, x, y), NULL, w, 1, color);
+    }
 }
 
+/* viewport clipping, primitives are cut to the texture before rasterizing */
+
+/* narrows [x0, x1] to lo <= k * x + m <= hi */
+
+static int pxClipSlab(
+    const float k, const float m, const float lo, const float hi, float* x0, float* x1)
+{
+    float a, b;
+    if (pxAbs(k) < 1e-6F) {
+        return m >= lo && m <= hi;
+    }
+
+    a = (lo - m) / k;
+    b = (hi - m) / k;
+    if (b < a) {
+        pxSwap(a, b, float);
+    }
+
+    *x0 = pxMax(*x0, a);
+    *x1 = pxMin(*x1, b);
+    return *x0 <= *x1;
+}
+
+/* narrows [t0, t1] to the part of the segment p + t * (q - p) inside [lo, hi] */
+
+static int pxClipSegment(
+    const vec2 p, const vec2 q, const vec2 lo, const vec2 hi, float* t0, float* t1)
+{
+    return pxClipSlab(q.x - p.x, p.x, lo.x, hi.x, t0, t1) &&
+        pxClipSlab(q.y - p.y, p.y, lo.y, hi.y, t0, t1);
+}
+
+/*
+ * Bresenham step i lands on minor offset floor((2 * i * dm + dM) / (2 * dM)),
+ * so the steps inside the texture are solved for directly and the loop
+ * starts at the first visible pixel with its error term already in place.
+ */
+
 void pxPlotLine(const Tex2D texture, ivec2 p, ivec2 q, const Px color)
 {
-    int error;
-    ivec2 d, s;
+    int i, first, last, major, minor, error;
+    int dM, dm, sM, sm, M, m, sizeM, sizem, stepM, stepm;
+    double lo, hi, t0, t1;
+    Px* px;
+    const int steep = pxAbs(q.y - p.y) > pxAbs(q.x - p.x);
 
-    d.x = q.x - p.x;
-    d.y = q.y - p.y;
-    s.x = pxSign(d.x);
-    s.y = pxSign(d.y);
-    d.x = pxAbs(d.x);
-    d.y = -pxAbs(d.y);
-    error = d.x + d.y;
+    pxDirtyBounds(texture, p.x, p.y, q.x, q.y);
+    if (steep) {
+        pxSwap(p.x, p.y, int);
+        pxSwap(q.x, q.y, int);
+    }
+
+    dM = pxAbs(q.x - p.x);
+    dm = pxAbs(q.y - p.y);
+    sM = pxSign(q.x - p.x);
+    sm = pxSign(q.y - p.y);
+    M = p.x;
+    m = p.y;
+    sizeM = steep ? texture.height : texture.width;
+    sizem = steep ? texture.width : texture.height;
+    stepM = steep ? sM * texture.width : sM;
+    stepm = steep ? sm : sm * texture.width;
+
+    if (!dM) {
+        if (steep) {
+            pxSwap(M, m, int);
+        }
+        pxPlot(texture, M, m, color);
+        return;
+    }
     
-    while (p.x != q.x || p.y != q.y) {
-        int e2 = error * 2;
-        pxPlot(texture, p.x, p.y, color);
-        if (e2 >= d.y) {
-            error = error + d.y;
-            p.x += s.x;
+    lo = sM > 0 ? -M : M - (sizeM - 1);
+    hi = sM > 0 ? sizeM - 1 - M : M;
+    t0 = pxMax(0.0, lo);
+    t1 = pxMin((double)dM, hi);
+
+    lo = sm > 0 ? -m : m - (sizem - 1);
+    hi = sm > 0 ? sizem - 1 - m : m;
+    if (dm && lo > 0.0) {
+        t0 = pxMax(t0, ceil((2.0 * lo - 1.0) * dM / (2.0 * dm)));
+    }
+    if (dm && hi < (double)dm) {
+        t1 = pxMin(t1, ceil((2.0 * hi + 1.0) * dM / (2.0 * dm)) - 1.0);
+    }
+    if (t0 > t1 || hi < 0.0 || lo > (double)dm) {
+        return;
+    }
+    first = (int)t0;
+    last = (int)t1;
+
+    lo = 2.0 * first * dm + dM;
+    minor = (int)floor(lo / (2.0 * dM));
+    error = (int)(lo - 2.0 * dM * minor);
+    major = M + sM * first;
+    minor = m + sm * minor;
+    px = steep ? &pxAt(texture, minor, major) : &pxAt(texture, major, minor);
+
+    for (i = first; i <= last; ++i) {
+        *px = color;
+        px += stepM;
+        error += 2 * dm;
+        if (error >= 2 * dM) {
+            error -= 2 * dM;
+            px += stepm;
         }
-        if (e2 <= d.x) {
-            error = error + d.x;
-            p.y +=s.y;
+    }
+}
+
+/* antialiased line runs, unchecked where both rows are known to be inside */
+
+static float pxLineSmoothRun(
+    const Tex2D texture, const int steep, int x, const int end, 
+    float intery, const float g, const Px color)
+{
+    for (; x <= end; ++x) {
+        const int y = floor(intery);
+        const float fpart = intery - (float)y;
+        if (steep) {
+            pxBlend(texture, y, x, 1.0F - fpart, color);
+            pxBlend(texture, y + 1, x, fpart, color);
+        } else {
+            pxBlend(texture, x, y, 1.0F - fpart, color);
+            pxBlend(texture, x, y + 1, fpart, color);
         }
+        intery += g;
     }
-    
-    pxPlot(texture, p.x, p.y, color);
+    return intery;
+}
+
+static float pxLineSmoothFast(
+    const Tex2D texture, const int steep, int x, const int end, 
+    float intery, const float g, const Px color)
+{
+    const int stepx = steep ? texture.width : 1, stepy = steep ? 1 : texture.width;
+    for (; x <= end; ++x) {
+        const int y = floor(intery);
+        const float fpart = intery - (float)y;
+        Px* px = texture.pixbuf + x * stepx + y * stepy;
+        px[0] = pxLerp(px[0], color, 1.0F - fpart);
+        px[stepy] = pxLerp(px[stepy], color, fpart);
+        intery += g;
+    }
+    return intery;
 }
 
 void pxPlotLineSmooth(const Tex2D texture, vec2 p, vec2 q, const Px color)
 {
     const int steep = pxAbs(q.y - p.y) > pxAbs(q.x - p.x);
-    int x, xpos1, ypos1, xpos2, ypos2;
-    float g, dx, dy, xend, yend, xgap, fpart, rfpart, intery;
+    const int width = steep ? texture.height : texture.width;
+    const int height = steep ? texture.width : texture.height;
+    int xpos1, ypos1, xpos2, ypos2, startx, endx, safex0, safex1;
+    float g, dx, dy, xend, yend, xgap, fpart, rfpart, intery, t0 = 0.0F, t1 = 1.0F;
+    vec2 hull[2], lo, hi;
+
+    hull[0] = p;
+    hull[1] = q;
+    pxDirtyHull(texture, hull, 2);
     
     if (steep) {
         pxSwap(p.x, p.y, float);
@@ -253,6 +707,22 @@ void pxPlotLineSmooth(const Tex2D texture, vec2 p, vec2 q, const Px color)
     dy = q.y - p.y;
     g = (dx != 0.0F) ? dy / dx : 1.0F;
 
+    /* the margin keeps the endpoints of a clipped line out of sight */
+    lo.x = lo.y = -3.0F;
+    hi.x = (float)width + 2.0F;
+    hi.y = (float)height + 2.0F;
+    if (!pxClipSegment(p, q, lo, hi, &t0, &t1)) {
+        return;
+    }
+    if (t1 < 1.0F) {
+        q.x = p.x + dx * t1;
+        q.y = p.y + dy * t1;
+    }
+    if (t0 > 0.0F) {
+        p.x += dx * t0;
+        p.y += dy * t0;
+    }
+
     xend = floor(p.x);
     yend = p.y + g * (xend - p.x);
     xgap = 1.0F - ((p.x + 0.5F) - floor(p.x + 0.5F));
@@ -269,7 +739,8 @@ void pxPlotLineSmooth(const Tex2D texture, vec2 p, vec2 q, const Px color)
         pxBlend(texture, xpos1, ypos1 + 1, fpart * xgap, color);
     }
 
-    intery = yend + g;
+    startx = pxMax(xpos1 + 1, 0);
+    intery = yend + g * (float)(startx - xpos1);
     xend = floor(q.x);
     yend = q.y + g * (xend - q.x);
     xgap = 1.0F - ((q.x + 0.5F) - floor(q.x + 0.5F));
@@ -281,104 +752,639 @@ void pxPlotLineSmooth(const Tex2D texture, vec2 p, vec2 q, const Px color)
     if (steep) {
         pxBlend(texture, ypos2, xpos2, rfpart * xgap, color);
         pxBlend(texture, ypos2 + 1, xpos2, fpart * xgap, color);
-        for (x = xpos1 + 1; x < xpos2; ++x) {
-            const int y = floor(intery);
-            fpart = intery - (float)y;
-            rfpart = 1.0F - fpart;
-            pxBlend(texture, y, x, rfpart, color);
-            pxBlend(texture, y + 1, x, fpart, color);
-            intery += g;
-        }
     } else {
         pxBlend(texture, xpos2, ypos2, rfpart * xgap, color);
         pxBlend(texture, xpos2, ypos2 + 1, fpart * xgap, color);
-        for (x = xpos1 + 1; x < xpos2; ++x) {
-            const int y = floor(intery);
-            fpart = intery - (float)y;
-            rfpart = 1.0F - fpart;
-            pxBlend(texture, x, y, rfpart, color);
-            pxBlend(texture, x, y + 1, fpart, color);
-            intery += g;
-        }
     }
+    
+    /* a pixel of slack absorbs the drift of the accumulated intercept */
+    endx = pxMin(xpos2 - 1, width - 1);
+    lo.x = (float)startx;
+    lo.y = (float)endx;
+    if (!pxClipSlab(g, intery - g * (float)startx, 1.0F, (float)height - 2.0F, &lo.x, &lo.y)) {
+        lo.x = (float)endx + 1.0F;
+        lo.y = (float)endx;
+    }
+    safex0 = (int)ceil(lo.x);
+    safex1 = pxMax((int)floor(lo.y), safex0 - 1);
+
+    intery = pxLineSmoothRun(texture, steep, startx, safex0 - 1, intery, g, color);
+    intery = pxLineSmoothFast(texture, steep, safex0, safex1, intery, g, color);
+    pxLineSmoothRun(texture, steep, pxMax(safex0, safex1 + 1), endx, intery, g, color);
 }
 
-void pxPlotBezier2(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
+/* wide lines, the stroke is a union of convex pieces shaded by distance */
+
+typedef struct pxStrokePiece {
+    int count;
+    int round;
+    vec2 origin, dir;
+    float len, hw;
+    vec2 vertex[4];
+    vec2 normal[4];
+    float offset[4];
+    vec2 lo, hi;
+} pxStrokePiece;
+
+static vec2 pxStrokeDir(const vec2 a, const vec2 b, float* len)
 {
-    float t;
-    const float dx = pxAbs(b.x - a.x), dy = pxAbs(b.y - a.y);
-    const float dxy = dx + dy;
-    const float delta = dxy != 0.0F ? 1.0F / dxy : 1.0F;
-    
-    for (t = 0.0F; t < 1.0F; t += delta) {
-        vec2 p, q;
-        p = vec2_mix(a, c, t);
-        q = vec2_mix(c, b, t);
-        p = vec2_mix(p, q, t);
-        pxPlot(texture, (int)p.x, (int)p.y, col);
+    vec2 d;
+    d.x = b.x - a.x;
+    d.y = b.y - a.y;
+    *len = sqrt(d.x * d.x + d.y * d.y);
+    if (*len > 0.0F) {
+        d.x /= *len;
+        d.y /= *len;
     }
+    return d;
 }
 
-void pxPlotBezier2Smooth(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
+/* convex join wedges become outward half-planes, degenerate ones are empty */
+
+static void pxStrokePolygon(pxStrokePiece* piece, const vec2* v, const int count)
+{
+    int k;
+    float area = 0.0F;
+    for (k = 0; k < count; ++k) {
+        const vec2 a = v[k], b = v[(k + 1) % count];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    if (pxAbs(area) < 1e-6F) {
+        return;
+    }
+
+    piece->lo = piece->hi = v[0];
+    for (k = 0; k < count; ++k) {
+        float len;
+        const vec2 d = pxStrokeDir(v[k], v[(k + 1) % count], &len);
+        piece->normal[k].x = area > 0.0F ? d.y : -d.y;
+        piece->normal[k].y = area > 0.0F ? -d.x : d.x;
+        piece->offset[k] = piece->normal[k].x * v[k].x + piece->normal[k].y * v[k].y;
+        piece->vertex[k] = v[k];
+        piece->lo.x = pxMin(piece->lo.x, v[k].x);
+        piece->lo.y = pxMin(piece->lo.y, v[k].y);
+        piece->hi.x = pxMax(piece->hi.x, v[k].x);
+        piece->hi.y = pxMax(piece->hi.y, v[k].y);
+    }
+    piece->count = count;
+}
+
+/*
+ * Even pieces are the segments, odd ones the miter or bevel wedges joining
+ * them. Round joins need no wedge, their segments get round caps instead.
+ */
+
+static void pxStrokeBuild(
+    const vec2* p, const int index, const float hw, const int join, pxStrokePiece* piece)
 {
-    float t;
-    vec2 q, p = a;
-    const float dx = pxAbs(b.x - a.x), dy = pxAbs(b.y - a.y);
-    const float dxy = pxMax(dx, dy);
-    const float delta = dxy != 0.0F ? 1.0F / dxy : 1.0F;
+    float len0, len1;
+    vec2 d0, d1, v[4];
+    const int i = (index + 1) / 2;
+
+    piece->count = -1;
+    if (!(index & 1)) {
+        const float r = hw;
+        piece->origin = p[i];
+        piece->dir = pxStrokeDir(p[i], p[i + 1], &piece->len);
+        piece->hw = hw;
+        piece->round = join == SPXP_JOIN_ROUND;
+        piece->lo.x = pxMin(p[i].x, p[i + 1].x) - r;
+        piece->lo.y = pxMin(p[i].y, p[i + 1].y) - r;
+        piece->hi.x = pxMax(p[i].x, p[i + 1].x) + r;
+        piece->hi.y = pxMax(p[i].y, p[i + 1].y) + r;
+        piece->count = piece->len > 0.0F || piece->round ? 0 : -1;
+        return;
+    }
+
+    if (join == SPXP_JOIN_ROUND) {
+        return;
+    }
+
+    d0 = pxStrokeDir(p[i - 1], p[i], &len0);
+    d1 = pxStrokeDir(p[i], p[i + 1], &len1);
+    if (len0 > 0.0F && len1 > 0.0F) {
+        
+        /* the wedge sits on the outer side of the turn */
+        const float s = d0.x * d1.y - d0.y * d1.x > 0.0F ? -hw : hw;
+        const float dot = d0.x * d1.x + d0.y * d1.y;
+        v[0] = p[i];
+        v[1].x = p[i].x - s * d0.y;
+        v[1].y = p[i].y + s * d0.x;
+        v[3].x = p[i].x - s * d1.y;
+        v[3].y = p[i].y + s * d1.x;
+        if (join == SPXP_JOIN_MITER && 1.0F + dot > 2.0F / (SPXP_MITER_LIMIT * SPXP_MITER_LIMIT)) {
+            v[2].x = p[i].x - s * (d0.y + d1.y) / (1.0F + dot);
+            v[2].y = p[i].y + s * (d0.x + d1.x) / (1.0F + dot);
+            pxStrokePolygon(piece, v, 4);
+        } else {
+            v[2] = v[3];
+            pxStrokePolygon(piece, v, 3);
+        }
+    }
+}
 
-    for (t = delta; t < 1.0; t += delta) {
-        vec2 p1 = vec2_mix(a, c, t);
-        vec2 p2 = vec2_mix(c, b, t);
-        q = vec2_mix(p1, p2, t);
-        pxPlotLineSmooth(texture, p, q, col);
-        p = q;
+/* 
+ * Signed distance to a piece, only exact when below bound. The farthest
+ * half-plane of a wedge is merely a lower bound outside of it, so close
+ * outside points are measured to its edges.
+ */
+
+static float pxStrokeDistance(
+    const pxStrokePiece* piece, const float x, const float y, const float bound)
+{
+    int k;
+    float d, sqr;
+    if (piece->count < 0 ||
+        x < piece->lo.x - bound || y < piece->lo.y - bound ||
+        x > piece->hi.x + bound || y > piece->hi.y + bound) {
+        return 1e30F;
     }
     
-    q = b;
-    pxPlotLineSmooth(texture, p, q, col);
+    if (!piece->count) {
+        const float ox = x - piece->origin.x, oy = y - piece->origin.y;
+        const float u = ox * piece->dir.x + oy * piece->dir.y;
+        const float v = pxAbs(oy * piece->dir.x - ox * piece->dir.y);
+        if (piece->round) {
+            const float du = u - pxClamp(u, 0.0F, piece->len);
+            sqr = du * du + v * v;
+            return sqr >= (piece->hw + bound) * (piece->hw + bound) ? bound :
+                sqrt(sqr) - piece->hw;
+        }
+        
+        d = pxMax(-u, u - piece->len);
+        if (d > 0.0F && v > piece->hw) {
+            return sqrt(d * d + (v - piece->hw) * (v - piece->hw));
+        }
+        return pxMax(d, v - piece->hw);
+    }
+
+    d = piece->normal[0].x * x + piece->normal[0].y * y - piece->offset[0];
+    for (k = 1; k < piece->count; ++k) {
+        d = pxMax(d, piece->normal[k].x * x + piece->normal[k].y * y - piece->offset[k]);
+    }
+    if (d <= 0.0F || d >= bound) {
+        return d;
+    }
+
+    sqr = 1e30F;
+    for (k = 0; k < piece->count; ++k) {
+        const vec2 a = piece->vertex[k], b = piece->vertex[(k + 1) % piece->count];
+        const float ex = b.x - a.x, ey = b.y - a.y;
+        const float ee = ex * ex + ey * ey;
+        const float t = ee > 0.0F ? pxClamp(((x - a.x) * ex + (y - a.y) * ey) / ee, 0.0F, 1.0F) : 0.0F;
+        const float dx = x - a.x - t * ex, dy = y - a.y - t * ey;
+        sqr = pxMin(sqr, dx * dx + dy * dy);
+    }
+    return sqrt(sqr);
 }
 
-void pxPlotBezier3(
-    const Tex2D texture, vec2 a, vec2 b, vec2 c, vec2 d, const Px col)
+/*
+ * The part of row y where a piece may lie within bound, a superset outside
+ * the piece but exact inside, so a bound of -0.5 gives its fully covered
+ * pixels.
+ */
+
+static int pxStrokeReach(
+    const pxStrokePiece* piece, const float y, const float bound, float* x0, float* x1)
 {
-    float t;
-    vec2 q, p = a;
-    const float dx = pxAbs(d.x - a.x), dy = pxAbs(d.y - a.y);
-    const float dxy = dx + dy;
-    const float delta = dxy != 0.0F ? 4.0F / dxy : 1.0F;
+    int k;
+    float r, ox, oy, dx, dy;
+    *x0 = -1e30F;
+    *x1 = 1e30F;
+    if (piece->count > 0) {
+        for (k = 0; k < piece->count; ++k) {
+            const float m = piece->normal[k].y * y - piece->offset[k];
+            if (!pxClipSlab(piece->normal[k].x, m, -1e30F, bound, x0, x1)) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    
+    r = piece->hw + bound;
+    if (piece->count < 0 || r < 0.0F) {
+        return 0;
+    }
     
-    for (t = delta; t < 1.0F; t += delta) { 
-        float u = 1.0F - t;
-        float tt = t * t;
-        float uu = u * u;
-        float uuu = uu * u;
-        float ttt = tt * t;
-        float uut = 3.0F * uu * t;
-        float utt = 3.0F * u * tt;
+    ox = piece->origin.x;
+    oy = piece->origin.y;
+    dx = piece->dir.x;
+    dy = piece->dir.y;
+    if (!piece->round) {
+        return piece->len + 2.0F * bound >= 0.0F &&
+            pxClipSlab(-dy, dx * (y - oy) + dy * ox, -r, r, x0, x1) &&
+            pxClipSlab(dx, dy * (y - oy) - dx * ox, -bound, piece->len + bound, x0, x1);
+    }
+
+    /* a capsule is convex, so its row is the hull of the body and both caps */
+    if (piece->len <= 0.0F || 
+        !pxClipSlab(-dy, dx * (y - oy) + dy * ox, -r, r, x0, x1) ||
+        !pxClipSlab(dx, dy * (y - oy) - dx * ox, 0.0F, piece->len, x0, x1)) {
+        *x0 = 1e30F;
+        *x1 = -1e30F;
+    }
+    for (k = 0; k < 2; ++k) {
+        const float h = y - oy - k * piece->len * dy;
+        if (h * h <= r * r) {
+            const float cx = ox + k * piece->len * dx, w = sqrt(r * r - h * h);
+            *x0 = pxMin(*x0, cx - w);
+            *x1 = pxMax(*x1, cx + w);
+        }
+    }
+    return *x0 <= *x1;
+}
+
+/* 
+ * The pieces reaching one row of a segment, each measured only over its
+ * bounds, and the clear part of the row inside the segment's body that no
+ * other piece reaches, where the distance is simply the one across it.
+ */
+
+typedef struct pxStrokeRow {
+    const pxStrokePiece* pieces[6];
+    int index[6], lo[6], hi[6];
+    int count;
+    int clear0, clear1;
+    float v0, vx, top;
+} pxStrokeRow;
+
+/* removes lo to hi from the pixel span x0 to x1, keeping its longer side */
+
+static void pxStrokeCut(const int lo, const int hi, int* x0, int* x1)
+{
+    if (lo <= *x1 && hi >= *x0) {
+        if (lo - *x0 >= *x1 - hi) {
+            *x1 = lo - 1;
+        } else {
+            *x0 = hi + 1;
+        }
+    }
+}
+
+static void pxStrokeRun(
+    const Tex2D texture, const pxStrokeRow* row, const int seg, 
+    const int x0, const int x1, const int y, const Px color)
+{
+    int i, x;
+    uint8_t mask[SPXP_SPAN_MAX];
+    const float fy = (float)y, tie = 1.0F / 512.0F;
+    for (x = x0; x <= x1; x += SPXP_SPAN_MAX) {
         
-        q.x = uuu * a.x + uut * b.x + utt * c.x + ttt * d.x;
-        q.y = uuu * a.y + uut * b.y + utt * c.y + ttt * d.y;
-        pxPlotLineSmooth(texture, vec2_floor(p), vec2_floor(q), col);
-        p = q;
+        const int span = pxMin(x1 - x + 1, SPXP_SPAN_MAX);
+        for (i = 0; i < span; ++i) {
+            
+            /* the first piece covering the pixel fully or the closest one */
+            int k, nearest = -1;
+            float dist = 0.5F;
+            if (x + i >= row->clear0 && x + i <= row->clear1) {
+                const float v = row->v0 + row->vx * (float)(x + i);
+                mask[i] = (uint8_t)(pxClamp(row->top - pxAbs(v), 0.0F, 1.0F) * 255.0F + 0.5F);
+                continue;
+            }
+
+            for (k = 0; k < row->count && dist > -0.5F; ++k) {
+                if (x + i >= row->lo[k] && x + i <= row->hi[k]) {
+                    const float d = pxStrokeDistance(row->pieces[k], (float)(x + i), fy, dist);
+                    if (d < dist - tie) {
+                        dist = pxMax(d, -0.5F);
+                        nearest = row->index[k];
+                    }
+                }
+            }
+
+            mask[i] = 0;
+            if (nearest >= 0 && (nearest + 1) / 2 == seg) {
+                mask[i] = (uint8_t)((0.5F - dist) * 255.0F + 0.5F);
+            }
+        }
+
+        pxBlendMask(&pxAt(texture, x, y), mask, (size_t)span, color);
+    }
+}
+
+/*
+ * Segment i rasterizes the pixels around itself and its start wedge and
+ * shades them by the distance to the nearest piece among its neighbours.
+ * A pixel is only blended by the segment owning that piece, so shared
+ * vertices are never blended twice. Near ties go to the earlier piece,
+ * which is how round joins leave the pixels behind a segment's start to
+ * the previous one. Each row's fully covered interior is solved from the
+ * segment's edges and filled as a span, less what the previous segment
+ * already covers, so distances are only measured on the fringe and only
+ * against the pieces whose bounds reach it.
+ */
+
+static void pxStrokeSegment(
+    const Tex2D texture, const vec2* p, const int count, const int seg, 
+    const float hw, const int join, const Px color)
+{
+    int i, y, first, last, starty, endy;
+    pxStrokePiece pieces[6];
+    const pxStrokePiece *own, *wedge = NULL;
+    const float reach = hw + 0.5F, tie = 1.0F / 512.0F;
+    const float behind = join != SPXP_JOIN_ROUND ? 0.5F : seg > 0 ? tie : reach;
+    const float ahead = join != SPXP_JOIN_ROUND ? 0.5F : reach;
+    const float body = join != SPXP_JOIN_ROUND ? 0.5F : 0.0F;
+    const int total = 2 * count - 3;
+
+    first = pxMax(2 * seg - 3, 0);
+    last = pxMin(2 * seg + 2, total - 1);
+    for (i = first; i <= last; ++i) {
+        pxStrokeBuild(p, i, hw, join, pieces + i - first);
+    }
+
+    own = pieces + 2 * seg - first;
+    if (seg > 0 && own[-1].count > 0) {
+        wedge = own - 1;
+    }
+
+    starty = (int)ceil(own->lo.y - 0.5F);
+    endy = (int)floor(own->hi.y + 0.5F);
+    if (wedge) {
+        starty = pxMin(starty, (int)ceil(wedge->lo.y - 0.5F));
+        endy = pxMax(endy, (int)floor(wedge->hi.y + 0.5F));
+    }
+    starty = pxMax(starty, 0);
+    endy = pxMin(endy, texture.height - 1);
+
+    for (y = starty; y <= endy; ++y) {
+        
+        int k, startx, endx, innerx0, innerx1;
+        pxStrokeRow row;
+        const float fy = (float)y, ox = own->origin.x, oy = own->origin.y;
+        const float dx = own->dir.x, dy = own->dir.y;
+        float x0 = -1e30F, x1 = 1e30F, sx0 = 1e30F, sx1 = -1e30F;
+        
+        if (own->count == 0 &&
+            pxClipSlab(-dy, dx * (fy - oy) + dy * ox, -reach, reach, &x0, &x1) &&
+            pxClipSlab(dx, dy * (fy - oy) - dx * ox, -behind, own->len + ahead, &x0, &x1)) {
+            sx0 = x0;
+            sx1 = x1;
+        }
+        if (wedge && fy >= wedge->lo.y - 0.5F && fy <= wedge->hi.y + 0.5F &&
+            pxStrokeReach(wedge, fy, 0.5F, &x0, &x1)) {
+            sx0 = pxMin(sx0, x0);
+            sx1 = pxMax(sx1, x1);
+        }
+        if (sx1 < sx0) {
+            continue;
+        }
+
+        startx = (int)ceil(pxMax(sx0, 0.0F));
+        endx = (int)floor(pxMin(sx1, (float)(texture.width - 1)));
+        if (endx < startx) {
+            continue;
+        }
+
+        innerx0 = row.clear0 = endx + 1;
+        innerx1 = row.clear1 = endx;
+        if (pxStrokeReach(own, fy, -0.5F, &x0, &x1)) {
+            innerx0 = pxMax((int)ceil(x0), startx);
+            innerx1 = pxMin((int)floor(x1), endx);
+        }
+
+        /* the body, where the distance to the segment is the one across it */
+        x0 = -1e30F;
+        x1 = 1e30F;
+        if (own->count == 0 && own->len > 2.0F * body &&
+            pxClipSlab(dx, dy * (fy - oy) - dx * ox, body, own->len - body, &x0, &x1)) {
+            row.clear0 = pxMax((int)ceil(x0), startx);
+            row.clear1 = pxMin((int)floor(x1), endx);
+        }
+        row.v0 = dx * (fy - oy) + dy * ox;
+        row.vx = -dy;
+        row.top = reach;
+        row.count = 0;
+
+        for (k = first; k <= last; ++k) {
+            
+            const pxStrokePiece* piece = pieces + k - first;
+            const int lo = (int)ceil(piece->lo.x - 0.5F), hi = (int)floor(piece->hi.x + 0.5F);
+            if (piece->count < 0 || fy < piece->lo.y - 0.5F || fy > piece->hi.y + 0.5F ||
+                lo > endx || hi < startx) {
+                continue;
+            }
+
+            row.pieces[row.count] = piece;
+            row.index[row.count] = k;
+            row.lo[row.count] = lo;
+            row.hi[row.count++] = hi;
+            if (piece != own) {
+                pxStrokeCut(lo, hi, &row.clear0, &row.clear1);
+            }
+            
+            /* the previous segment's pieces win ties over the interior */
+            if (k < 2 * seg - 1 && innerx0 <= innerx1 && lo <= innerx1 && hi >= innerx0 &&
+                pxStrokeReach(piece, fy, -0.5F, &x0, &x1)) {
+                pxStrokeCut((int)ceil(x0), (int)floor(x1), &innerx0, &innerx1);
+            }
+        }
+        if (innerx0 > innerx1) {
+            innerx0 = endx + 1;
+            innerx1 = endx;
+        }
+
+        pxStrokeRun(texture, &row, seg, startx, innerx0 - 1, y, color);
+        if (innerx0 <= innerx1) {
+            pxFillSpan(&pxAt(texture, innerx0, y), (size_t)(innerx1 - innerx0 + 1), color);
+        }
+        pxStrokeRun(texture, &row, seg, innerx1 + 1, endx, y, color);
     }
+}
+
+void pxPlotPolyline(
+    const Tex2D texture, const vec2* p, int count, float width, int join, const Px color)
+{
+    int i;
+    float reach;
+    const float hw = width * 0.5F;
+    vec2 lo, hi;
+    if (count < 2 || hw <= 0.0F) {
+        return;
+    }
+
+    lo = hi = p[0];
+    for (i = 1; i < count; ++i) {
+        lo.x = pxMin(lo.x, p[i].x);
+        lo.y = pxMin(lo.y, p[i].y);
+        hi.x = pxMax(hi.x, p[i].x);
+        hi.y = pxMax(hi.y, p[i].y);
+    }
+
+    reach = (join == SPXP_JOIN_MITER ? SPXP_MITER_LIMIT * hw : hw) + 1.0F;
+    pxDirtyBounds(
+        texture, (int)floor(lo.x - reach), (int)floor(lo.y - reach), 
+        (int)ceil(hi.x + reach), (int)ceil(hi.y + reach)
+    );
     
-    q = d;
-    pxPlotLineSmooth(texture, p, q, col);
+    for (i = 0; i < count - 1; ++i) {
+        pxStrokeSegment(texture, p, count, i, hw, join, color);
+    }
+}
+
+void pxPlotLineWide(const Tex2D texture, vec2 p, vec2 q, float width, const Px color)
+{
+    vec2 line[2];
+    line[0] = p;
+    line[1] = q;
+    pxPlotPolyline(texture, line, 2, width, SPXP_JOIN_BEVEL, color);
+}
+
+/*
+ * Curve flattening, the control hull is split until each piece is off
+ * screen or within SPXP_CURVE_TOLERANCE of its chord. Visible chords are
+ * gathered into runs and drawn as one polyline, so shared vertices are
+ * only blended once.
+ */
+
+typedef struct pxCurve {
+    vec2 points[SPXP_CURVE_POINTS];
+    int count;
+    int smooth;
+    Px color;
+} pxCurve;
+
+static void pxCurveFlush(const Tex2D texture, pxCurve* curve)
+{
+    int i;
+    if (curve->count >= 2 && curve->smooth) {
+        pxPlotPolyline(texture, curve->points, curve->count, 1.0F, SPXP_JOIN_ROUND, curve->color);
+    } else if (curve->count >= 2) {
+        for (i = 0; i < curve->count - 1; ++i) {
+            ivec2 p, q;
+            p.x = (int)floor(curve->points[i].x);
+            p.y = (int)floor(curve->points[i].y);
+            q.x = (int)floor(curve->points[i + 1].x);
+            q.y = (int)floor(curve->points[i + 1].y);
+            pxPlotLine(texture, p, q, curve->color);
+        }
+    }
+    curve->count = 0;
+}
+
+static void pxCurveVertex(const Tex2D texture, pxCurve* curve, const vec2 p)
+{
+    if (curve->count == SPXP_CURVE_POINTS) {
+        const vec2 last = curve->points[curve->count - 1];
+        pxCurveFlush(texture, curve);
+        curve->points[curve->count++] = last;
+    }
+    curve->points[curve->count++] = p;
+}
+
+/* distance bound between a piece and its chord, n * (n - 1) / 8 * max |second difference| */
+
+static int pxCurveFlat(const vec2* p, const int count)
+{
+    int i;
+    float sqr = 0.0F;
+    const float scale = count == 3 ? 0.25F : 0.75F;
+    for (i = 0; i + 2 < count; ++i) {
+        const float dx = p[i].x - 2.0F * p[i + 1].x + p[i + 2].x;
+        const float dy = p[i].y - 2.0F * p[i + 1].y + p[i + 2].y;
+        sqr = pxMax(sqr, dx * dx + dy * dy);
+    }
+    return sqr * scale * scale <= SPXP_CURVE_TOLERANCE * SPXP_CURVE_TOLERANCE;
+}
+
+static void pxCurveFlatten(
+    const Tex2D texture, const vec2* p, const int count, const int depth, pxCurve* curve)
+{
+    int i, j;
+    vec2 lo = p[0], hi = p[0], left[4], right[4], tmp[4];
+
+    for (i = 1; i < count; ++i) {
+        lo.x = pxMin(lo.x, p[i].x);
+        lo.y = pxMin(lo.y, p[i].y);
+        hi.x = pxMax(hi.x, p[i].x);
+        hi.y = pxMax(hi.y, p[i].y);
+    }
+
+    if (hi.x < -2.0F || hi.y < -2.0F || 
+        lo.x > (float)texture.width + 1.0F || lo.y > (float)texture.height + 1.0F) {
+        pxCurveFlush(texture, curve);
+        return;
+    }
+    if (!depth || pxCurveFlat(p, count)) {
+        if (!curve->count) {
+            pxCurveVertex(texture, curve, p[0]);
+        }
+        pxCurveVertex(texture, curve, p[count - 1]);
+        return;
+    }
+
+    for (i = 0; i < count; ++i) {
+        tmp[i] = p[i];
+    }
+    for (i = 0; i < count; ++i) {
+        left[i] = tmp[0];
+        right[count - 1 - i] = tmp[count - 1 - i];
+        for (j = 0; j < count - 1 - i; ++j) {
+            tmp[j] = vec2_mix(tmp[j], tmp[j + 1], 0.5F);
+        }
+    }
+
+    pxCurveFlatten(texture, left, count, depth - 1, curve);
+    pxCurveFlatten(texture, right, count, depth - 1, curve);
+}
+
+static void pxPlotCurve(
+    const Tex2D texture, const vec2* p, const int count, const int smooth, const Px color)
+{
+    pxCurve curve;
+    curve.count = 0;
+    curve.smooth = smooth;
+    curve.color = color;
+    pxDirtyHull(texture, p, count);
+    pxCurveFlatten(texture, p, count, SPXP_CLIP_DEPTH, &curve);
+    pxCurveFlush(texture, &curve);
+}
+
+void pxPlotBezier2(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
+{
+    vec2 p[3];
+    p[0] = a;
+    p[1] = c;
+    p[2] = b;
+    pxPlotCurve(texture, p, 3, 0, col);
+}
+
+void pxPlotBezier2Smooth(const Tex2D texture, vec2 a, vec2 b, vec2 c, const Px col)
+{
+    vec2 p[3];
+    p[0] = a;
+    p[1] = c;
+    p[2] = b;
+    pxPlotCurve(texture, p, 3, 1, col);
+}
+
+void pxPlotBezier3(
+    const Tex2D texture, vec2 a, vec2 b, vec2 c, vec2 d, const Px col)
+{
+    vec2 p[4];
+    p[0] = a;
+    p[1] = b;
+    p[2] = c;
+    p[3] = d;
+    pxPlotCurve(texture, p, 4, 1, col);
 }
 
 void pxPlotRect(const Tex2D texture, ivec2 p, ivec2 q, const Px color)
 {
-    int x, y;
+    int y;
     const int resx = texture.width - 1, resy = texture.height - 1;
     const int starty = pxClamp(p.y - q.y, 0, resy);
     const int endy = pxClamp(p.y + q.y, 0, resy);
     const int startx = pxClamp(p.x - q.x, 0, resx);
     const int endx = pxClamp(p.x + q.x, 0, resx);
+    pxDirtyBounds(texture, startx, starty, endx, endy);
+    if (startx > endx) {
+        return;
+    }
+
     for (y = starty; y <= endy; ++y) {
-        for (x = startx; x <= endx; ++x) {
-            pxAt(texture, x, y) = color;
-        }
+        pxFillSpan(&pxAt(texture, startx, y), (size_t)(endx - startx + 1), color);
     }
 }
 
@@ -425,26 +1431,6 @@ static void pxSortTri(ivec2 t[3])
         pxSwap(t[2], t[1], ivec2);
 }
 
-static void pxSortTrif(vec2 t[3])
-{
-    if (t[2].y < t[0].y || (t[2].y == t[0].y && t[2].x < t[0].x))
-        pxSwap(t[2], t[0], vec2);
-    if (t[1].y < t[0].y || (t[1].y == t[0].y && t[1].x < t[0].x))
-        pxSwap(t[1], t[0], vec2);
-    if (t[2].y < t[1].y || (t[2].y == t[1].y && t[2].x < t[1].x))
-        pxSwap(t[2], t[1], vec2);
-}
-
-static void pxSortTriVert2D(Vert2D t[3])
-{
-    if (t[2].pos.y < t[0].pos.y || (t[2].pos.y == t[0].pos.y && t[2].pos.x < t[0].pos.x))
-        pxSwap(t[2], t[0], Vert2D);
-    if (t[1].pos.y < t[0].pos.y || (t[1].pos.y == t[0].pos.y && t[1].pos.x < t[0].pos.x))
-        pxSwap(t[1], t[0], Vert2D);
-    if (t[2].pos.y < t[1].pos.y || (t[2].pos.y == t[1].pos.y && t[2].pos.x < t[1].pos.x))
-        pxSwap(t[2], t[1], Vert2D);
-}
-
 void pxPlotTri(const Tex2D texture, ivec2 p0, ivec2 p1, ivec2 p2, const Px color)
 {
     const int resx = texture.width - 1, resy = texture.height - 1;
@@ -459,6 +1445,10 @@ void pxPlotTri(const Tex2D texture, ivec2 p0, ivec2 p1, ivec2 p2, const Px color
 
     starty = pxMax(t[0].y, 0);
     endy = pxMin(t[2].y, resy);
+    pxDirtyBounds(
+        texture, pxMin(pxMin(t[0].x, t[1].x), t[2].x), starty, 
+        pxMax(pxMax(t[0].x, t[1].x), t[2].x), endy
+    );
     difx[0] = t[2].x - t[0].x;
     difx[1] = t[1].x - t[0].x;
     difx[2] = t[2].x - t[1].x;
@@ -469,7 +1459,7 @@ void pxPlotTri(const Tex2D texture, ivec2 p0, ivec2 p1, ivec2 p2, const Px color
 
     for (y = starty, n = 1; y <= endy; ++y) {
         
-        int x, startx, endx;
+        int startx, endx;
         float dx, dy, x0, x1;
         
         n += n == 1 && y >= t[1].y;
@@ -485,82 +1475,145 @@ void pxPlotTri(const Tex2D texture, ivec2 p0, ivec2 p1, ivec2 p2, const Px color
         startx = pxMax(x0, 0);
         endx = pxMin(x1, resx);
         
-        for (x = startx; x <= endx; ++x) {
-            pxAt(texture, x, y) = color;
+        if (startx <= endx) {
+            pxFillSpan(&pxAt(texture, startx, y), (size_t)(endx - startx + 1), color);
         }
     }
 }
 
-void pxPlotTriSmooth(const Tex2D texture, vec2 p0, vec2 p1, vec2 p2, const Px color)
-{
-    static const vec2 P[] = {
-        {0.0F, 0.0F}, {0.5F, 0.0F}, {0.0F, -0.5F}, {-0.5F, 0.0F}, {0.0F, 0.5F},
-        {0.5F, 0.5F}, {0.5F, -0.5F}, {-0.5F, -0.5F}, {-0.5F, 0.5F}
-    };
-    
-    const int resx = texture.width - 1, resy = texture.height - 1;
-    const float ni = (float)sizeof(P[0]) / (float)sizeof(P);
-    float difx[3], steps[3];
-    int y, n, starty, endy;
-    vec2 t[3];
-    
-    t[0] = p0;
-    t[1] = p1;
-    t[2] = p2;
-    pxSortTrif(t);
+/* half-space triangle rasterizer, edge functions over blocks of pixels */
 
-    starty = pxMax(t[0].y, 0);
-    endy = pxMin(t[2].y, resy);
-    
-    difx[0] = t[2].x - t[0].x;
-    difx[1] = t[1].x - t[0].x;
-    difx[2] = t[2].x - t[1].x;
-    
-    steps[0] = t[2].y - t[0].y ? 1.0F / (t[2].y - t[0].y) : 0.0F;
-    steps[1] = t[1].y - t[0].y ? 1.0F / (t[1].y - t[0].y) : 0.0F;
-    steps[2] = t[2].y - t[1].y ? 1.0F / (t[2].y - t[1].y) : 0.0F;
+typedef void (*pxTriSpanFunc)(
+    const Tex2D texture, int x, int y, int count, const uint8_t* mask, const void* data
+);
 
-    for (y = starty, n = 1; y <= (int)endy; ++y) {
-        
-        int startx, endx, x;
-        float d0, d1, x0, x1;
+typedef struct pxTriEdge {
+    vec2 origin;
+    float dx, dy;
+} pxTriEdge;
 
-        n += n == 1 && y >= t[1].y;
-        d0 = steps[0] != 0.0F ? steps[0] * ((float)y - t[0].y) : 1.0F;
-        d1 = steps[n] != 0.0F ? steps[n] * ((float)y - t[n - 1].y) : 1.0F;
-        x0 = t[0].x + difx[0] * pxMax(d0, 0.0F); 
-        x1 = t[n - 1].x + difx[n] * pxMax(d1, 0.0F);
-        
-        if (x1 < x0) {
-            pxSwap(x0, x1, float);
+static const vec2 pxTriSamples[] = {
+    {0.0F, 0.0F}, {0.5F, 0.0F}, {0.0F, -0.5F}, {-0.5F, 0.0F}, {0.0F, 0.5F},
+    {0.5F, 0.5F}, {0.5F, -0.5F}, {-0.5F, -0.5F}, {-0.5F, 0.5F}
+};
+
+static pxTriEdge pxTriEdgeMake(const vec2 a, const vec2 b)
+{
+    pxTriEdge e;
+    e.origin = a;
+    e.dx = b.y - a.y;
+    e.dy = a.x - b.x;
+    return e;
+}
+
+static float pxTriEdgeAt(const pxTriEdge* e, const float x, const float y)
+{
+    return (x - e->origin.x) * e->dx + (y - e->origin.y) * e->dy;
+}
+
+static void pxRasterTri(
+    const Tex2D texture, const vec2 p0, const vec2 p1, const vec2 p2, 
+    pxTriSpanFunc func, const void* data)
+{
+    const int samples = (int)(sizeof(pxTriSamples) / sizeof(pxTriSamples[0]));
+    const float extent = (float)SPXP_TRI_BLOCK;
+    int i, j, x, y, bx, by, minx, miny, maxx, maxy;
+    float offsets[3][sizeof(pxTriSamples) / sizeof(pxTriSamples[0])];
+    uint8_t mask[SPXP_TRI_BLOCK];
+    pxTriEdge e[3];
+
+    /* pixels are covered when all edge functions are positive */
+    e[0] = pxTriEdgeMake(p1, p2);
+    e[1] = pxTriEdgeMake(p2, p0);
+    e[2] = pxTriEdgeMake(p0, p1);
+    for (i = 0; i < 3; ++i) {
+        for (j = 0; j < samples; ++j) {
+            offsets[i][j] = pxTriSamples[j].x * e[i].dx + pxTriSamples[j].y * e[i].dy;
         }
+    }
+
+    /* every pixel with a sample that may land inside the triangle */
+    minx = pxMax((int)floor(pxMin(pxMin(p0.x, p1.x), p2.x) - 0.5F), 0);
+    miny = pxMax((int)floor(pxMin(pxMin(p0.y, p1.y), p2.y) - 0.5F), 0);
+    maxx = pxMin((int)floor(pxMax(pxMax(p0.x, p1.x), p2.x) + 0.5F), texture.width - 1);
+    maxy = pxMin((int)floor(pxMax(pxMax(p0.y, p1.y), p2.y) + 0.5F), texture.height - 1);
+    
+    for (by = miny - miny % SPXP_TRI_BLOCK; by <= maxy; by += SPXP_TRI_BLOCK) {
         
-        startx = pxMax(x0, 0);
-        endx = pxMin(x1 + 1, resx);
-        
-        for (x = startx; x < endx; ++x) {
+        const int y0 = pxMax(by, miny), y1 = pxMin(by + SPXP_TRI_BLOCK - 1, maxy);
+        for (bx = minx - minx % SPXP_TRI_BLOCK; bx <= maxx; bx += SPXP_TRI_BLOCK) {
             
-            vec2 p;
-            unsigned int j;
-            float sum = 0.0F;
+            int inside = 1, outside = 0;
+            const int x0 = pxMax(bx, minx), x1 = pxMin(bx + SPXP_TRI_BLOCK - 1, maxx);
             
-            p.x = (float)x;
-            p.y = (float)y;
-            
-            for (j = 0; j < sizeof(P) / sizeof(P[0]); ++j) {
-                vec2 q;
-                q.x = p.x + P[j].x;
-                q.y = p.y + P[j].y;
-                sum += (float)( vec2_determinant(p1, p2, q) >= 0.0F &&
-                                vec2_determinant(p2, p0, q) >= 0.0F &&
-                                vec2_determinant(p0, p1, q) >= 0.0F);
+            /* the extremes of each edge function over the samples of the block */
+            for (i = 0; i < 3; ++i) {
+                const float corner = pxTriEdgeAt(e + i, (float)bx - 0.5F, (float)by - 0.5F);
+                const float stepx = e[i].dx * extent, stepy = e[i].dy * extent;
+                inside &= corner + pxMin(stepx, 0.0F) + pxMin(stepy, 0.0F) >= 0.0F;
+                outside |= corner + pxMax(stepx, 0.0F) + pxMax(stepy, 0.0F) < 0.0F;
+            }
+
+            if (outside) {
+                continue;
             }
 
-            pxAt(texture, x, y) = pxLerp(pxAt(texture, x, y), color, sum * ni);
+            for (y = y0; y <= y1; ++y) {
+                
+                float d[3];
+                if (inside) {
+                    func(texture, x0, y, x1 - x0 + 1, NULL, data);
+                    continue;
+                }
+
+                for (i = 0; i < 3; ++i) {
+                    d[i] = pxTriEdgeAt(e + i, (float)x0, (float)y);
+                }
+
+                for (x = x0; x <= x1; ++x) {
+                    int sum = 0;
+                    for (j = 0; j < samples; ++j) {
+                        sum += (d[0] + offsets[0][j] >= 0.0F &&
+                                d[1] + offsets[1][j] >= 0.0F &&
+                                d[2] + offsets[2][j] >= 0.0F);
+                    }
+                    mask[x - x0] = (uint8_t)((sum * 255 + samples / 2) / samples);
+                    d[0] += e[0].dx;
+                    d[1] += e[1].dx;
+                    d[2] += e[2].dx;
+                }
+
+                func(texture, x0, y, x1 - x0 + 1, mask, data);
+            }
         }
     }
 }
 
+static void pxTriSmoothSpan(
+    const Tex2D texture, int x, int y, int count, const uint8_t* mask, const void* data)
+{
+    const Px color = *(const Px*)data;
+    if (mask) {
+        pxBlendMask(&pxAt(texture, x, y), mask, (size_t)count, color);
+    } else {
+        pxFillSpan(&pxAt(texture, x, y), (size_t)count, color);
+    }
+}
+
+void pxPlotTriSmooth(const Tex2D texture, vec2 p0, vec2 p1, vec2 p2, const Px color)
+{
+    vec2 hull[3];
+    hull[0] = p0;
+    hull[1] = p1;
+    hull[2] = p2;
+    pxDirtyHull(texture, hull, 3);
+
+    /* triangles are one sided, the other winding covers no samples */
+    if (vec2_determinant(p1, p2, p0) > 0.0F) {
+        pxRasterTri(texture, p0, p1, p2, pxTriSmoothSpan, &color);
+    }
+}
+
 Px pxTexMap(const Tex2D texture, vec2 uv)
 {
     float x = (float)(texture.width - 1) * (uv.x - floor(uv.x));
@@ -571,7 +1624,7 @@ Px pxTexMap(const Tex2D texture, vec2 uv)
 Px pxTexMapBilinear(const Tex2D texture, vec2 uv)
 {
     vec2 fcoord;
-    ivec2 icoord;
+    ivec2 icoord, next;
     Px samples[4];
     fcoord.x = uv.x * (texture.width - 1);
     fcoord.y = uv.y * (texture.height - 1);
@@ -579,105 +1632,280 @@ Px pxTexMapBilinear(const Tex2D texture, vec2 uv)
     icoord.y = (int)fcoord.y;
     fcoord.x -= icoord.x;
     fcoord.y -= icoord.y;
+    
+    /* the last row and column have no neighbour past them */
+    next.x = pxMin(icoord.x + 1, texture.width - 1);
+    next.y = pxMin(icoord.y + 1, texture.height - 1);
     samples[0] = pxAt(texture, icoord.x, icoord.y);
-    samples[1] = pxAt(texture, icoord.x + 1, icoord.y);
-    samples[2] = pxAt(texture, icoord.x, icoord.y + 1);
-    samples[3] = pxAt(texture, icoord.x + 1, icoord.y + 1);
+    samples[1] = pxAt(texture, next.x, icoord.y);
+    samples[2] = pxAt(texture, icoord.x, next.y);
+    samples[3] = pxAt(texture, next.x, next.y);
     samples[0] = pxLerp(samples[0], samples[1], fcoord.x);
     samples[1] = pxLerp(samples[2], samples[3], fcoord.x);
     return pxLerp(samples[0], samples[1], fcoord.y);
 }
 
+/* affine uv interpolation from the edge functions of the triangle */
+
+typedef struct pxTriTexture {
+    Tex2D texture;
+    Vert2D v[3];
+    pxTriEdge e[3];
+    float area;
+} pxTriTexture;
+
+static void pxTriTexSpan(
+    const Tex2D fb, int x, int y, int count, const uint8_t* mask, const void* data)
+{
+    int i, k;
+    vec2 uv, step;
+    const pxTriTexture* tri = (const pxTriTexture*)data;
+    
+    uv.x = uv.y = step.x = step.y = 0.0F;
+    for (k = 0; k < 3; ++k) {
+        const float w = pxTriEdgeAt(tri->e + k, (float)x, (float)y) / tri->area;
+        const float dw = tri->e[k].dx / tri->area;
+        uv.x += w * tri->v[k].uv.x;
+        uv.y += w * tri->v[k].uv.y;
+        step.x += dw * tri->v[k].uv.x;
+        step.y += dw * tri->v[k].uv.y;
+    }
+    
+    /* fringe pixel centres lie outside the triangle and so do their uvs */
+    for (i = 0; i < count; ++i, uv.x += step.x, uv.y += step.y) {
+        const unsigned int w = mask ? mask[i] : 255;
+        vec2 st;
+        st.x = pxClamp(uv.x, 0.0F, 1.0F);
+        st.y = pxClamp(uv.y, 0.0F, 1.0F);
+        if (w == 255) {
+            pxAt(fb, x + i, y) = pxTexMapBilinear(tri->texture, st);
+        } else if (w) {
+            pxBlendRun(&pxAt(fb, x + i, y), NULL, (uint8_t)w, 1, pxTexMapBilinear(tri->texture, st));
+        }
+    }
+}
+
 void pxPlotTriTex(const Tex2D fb, const Tex2D texture, Vert2D p0, Vert2D p1, Vert2D p2)
 {
-    static const vec2 P[] = {
-        {0.0F, 0.0F}, {1.0F, 0.0F}, {0.0F, -1.0F}, {-1.0F, 0.0F}, {0.0F, 1.0F}
-        ,{1.0F, 1.0F}, {1.0F, -1.0F}, {-1.0F, -1.0F}, {-1.0F, 1.0F}
-    };
+    pxTriTexture tri;
+    if (pxDirty) {
+        vec2 hull[3];
+        hull[0] = p0.pos;
+        hull[1] = p1.pos;
+        hull[2] = p2.pos;
+        pxDirtyHull(fb, hull, 3);
+    }
+    
+    tri.texture = texture;
+    tri.v[0] = p0;
+    tri.v[1] = p1;
+    tri.v[2] = p2;
+    tri.e[0] = pxTriEdgeMake(p1.pos, p2.pos);
+    tri.e[1] = pxTriEdgeMake(p2.pos, p0.pos);
+    tri.e[2] = pxTriEdgeMake(p0.pos, p1.pos);
+    tri.area = vec2_determinant(p1.pos, p2.pos, p0.pos);
+    if (tri.area > 0.0F) {
+        pxRasterTri(fb, p0.pos, p1.pos, p2.pos, pxTriTexSpan, &tri);
+    }
+}
 
-    const int resy = fb.height - 1;
-    const float ni = 1.0F / (sizeof(P) / sizeof(P[0]));
-    float difx[3], difu[3], difv[3], steps[3];
-    int y, n, starty, endy;
-    Vert2D t[3];
+/*
+ * Polygon fill, every edge adds its signed area to the cells of a tile of
+ * up to SPXP_FILL_ROWS by SPXP_SPAN_MAX pixels. A running sum along each
+ * row gives the winding coverage, resolved by the fill rule into a mask
+ * that is blended once. Pixel x covers [x - 0.5, x + 0.5) like elsewhere.
+ */
 
-    t[0] = p0;
-    t[1] = p1;
-    t[2] = p2;
-    pxSortTriVert2D(t);
+typedef struct pxFillTile {
+    float cell[SPXP_FILL_ROWS][SPXP_SPAN_MAX + 2];
+    int x, y, width, height;
+} pxFillTile;
 
-    starty = pxMax(t[0].pos.y, 0);
-    endy = pxMin(t[2].pos.y, resy);
-    
-    difx[0] = t[2].pos.x - t[0].pos.x;
-    difx[1] = t[1].pos.x - t[0].pos.x;
-    difx[2] = t[2].pos.x - t[1].pos.x;
-    
-    difu[0] = t[2].uv.x - t[0].uv.x;
-    difv[0] = t[2].uv.y - t[0].uv.y;
-    difu[1] = t[1].uv.x - t[0].uv.x;
-    difv[1] = t[1].uv.y - t[0].uv.y;
-    difu[2] = t[2].uv.x - t[1].uv.x;
-    difv[2] = t[2].uv.y - t[1].uv.y;
+/* edge with 0 <= y <= height and 0 <= x <= width in tile coordinates */
+
+static void pxFillLine(pxFillTile* tile, vec2 p, vec2 q)
+{
+    int y, starty, endy;
+    float dir = 1.0F, dxdy, x, lo, hi;
+    if (p.y == q.y) {
+        return;
+    }
+    if (p.y > q.y) {
+        pxSwap(p, q, vec2);
+        dir = -1.0F;
+    }
 
-    steps[0] = t[2].pos.y - t[0].pos.y ? 1.0F / (t[2].pos.y - t[0].pos.y) : 0.0F;
-    steps[1] = t[1].pos.y - t[0].pos.y ? 1.0F / (t[1].pos.y - t[0].pos.y) : 0.0F;
-    steps[2] = t[2].pos.y - t[1].pos.y ? 1.0F / (t[2].pos.y - t[1].pos.y) : 0.0F;
+    dxdy = (q.x - p.x) / (q.y - p.y);
+    lo = pxMin(p.x, q.x);
+    hi = pxMax(p.x, q.x);
+    starty = (int)p.y;
+    endy = pxMin((int)ceil(q.y), tile->height);
+    x = p.x;
 
-    for (y = starty, n = 1; y <= endy; ++y) {
+    for (y = starty; y < endy; ++y) {
+        
+        float* cell = tile->cell[y];
+        const float dy = pxMin((float)(y + 1), q.y) - pxMax((float)y, p.y);
+        const float xnext = (float)(y + 1) >= q.y ? q.x : pxClamp(x + dxdy * dy, lo, hi);
+        const float d = dy * dir;
+        const float x0 = pxMin(x, xnext), x1 = pxMax(x, xnext);
+        const int x0i = (int)x0, x1i = (int)ceil(x1);
+        
+        if (x1i <= x0i + 1) {
+            /* the edge stays inside one cell, split by its mean x */
+            const float xm = 0.5F * (x + xnext) - (float)x0i;
+            cell[x0i] += d - d * xm;
+            cell[x0i + 1] += d * xm;
+        } else {
+            /* trapezoids across the cells, the ends are triangles */
+            int i;
+            const float s = 1.0F / (x1 - x0);
+            const float x0f = x0 - (float)x0i, x1f = x1 - (float)x1i + 1.0F;
+            const float a0 = 0.5F * s * (1.0F - x0f) * (1.0F - x0f);
+            const float am = 0.5F * s * x1f * x1f;
+            cell[x0i] += d * a0;
+            if (x1i == x0i + 2) {
+                cell[x0i + 1] += d * (1.0F - a0 - am);
+            } else {
+                const float a1 = s * (1.5F - x0f);
+                const float a2 = a1 + (float)(x1i - x0i - 3) * s;
+                cell[x0i + 1] += d * (a1 - a0);
+                for (i = x0i + 2; i < x1i - 1; ++i) {
+                    cell[i] += d * s;
+                }
+                cell[x1i - 1] += d * (1.0F - a2 - am);
+            }
+            cell[x1i] += d * am;
+        }
         
-        vec2 uv0, uv1;
-        int x, startx, endx;
-        float d0, d1, x0, x1;
+        x = xnext;
+    }
+}
 
-        n += n == 1 && y >= t[1].pos.y; 
-        d0 = steps[0] != 0.0F ? steps[0] * ((float)y - t[0].pos.y) : 1.0F;
-        d1 = steps[n] != 0.0F ? steps[n] * ((float)y - t[n - 1].pos.y) : 1.0F;
-        x0 = t[0].pos.x + difx[0] * pxMax(d0, 0.0F); 
-        x1 = t[n - 1].pos.x + difx[n] * pxMax(d1, 0.0F);
+/* clips an edge to the tile, parts beside it run down the tile borders */
 
-        uv0.x = t[0].uv.x + difu[0] * pxMax(d0, 0.0F);
-        uv0.y = t[0].uv.y + difv[0] * pxMax(d0, 0.0F);
+static void pxFillEdge(pxFillTile* tile, const vec2 p, const vec2 q)
+{
+    int i, n = 0;
+    float t[4], t0 = 0.0F, t1 = 1.0F;
+    const float w = (float)tile->width, dx = q.x - p.x, dy = q.y - p.y;
+    if (p.y == q.y || pxMin(p.x, q.x) >= w ||
+        !pxClipSlab(dy, p.y, 0.0F, (float)tile->height, &t0, &t1)) {
+        return;
+    }
 
-        uv1.x = t[n - 1].uv.x + difu[n] * pxMax(d1, 0.0F);
-        uv1.y = t[n - 1].uv.y + difv[n] * pxMax(d1, 0.0F);
+    t[n++] = t0;
+    if (dx != 0.0F) {
+        const float a = -p.x / dx, b = (w - p.x) / dx;
+        if (pxMin(a, b) > t0 && pxMin(a, b) < t1) {
+            t[n++] = pxMin(a, b);
+        }
+        if (pxMax(a, b) > t0 && pxMax(a, b) < t1) {
+            t[n++] = pxMax(a, b);
+        }
+    }
+    t[n++] = t1;
+
+    for (i = 0; i + 1 < n; ++i) {
+        vec2 a, b;
+        a.x = pxClamp(p.x + dx * t[i], 0.0F, w);
+        a.y = pxClamp(p.y + dy * t[i], 0.0F, (float)tile->height);
+        b.x = pxClamp(p.x + dx * t[i + 1], 0.0F, w);
+        b.y = pxClamp(p.y + dy * t[i + 1], 0.0F, (float)tile->height);
+        pxFillLine(tile, a, b);
+    }
+}
 
-        if (x1 < x0) {
-            pxSwap(x0, x1, float);
-            pxSwap(uv0, uv1, vec2);
+static void pxFillResolve(const Tex2D texture, pxFillTile* tile, const int rule, const Px color)
+{
+    int x, y;
+    uint8_t mask[SPXP_SPAN_MAX];
+    for (y = 0; y < tile->height; ++y) {
+        
+        float* cell = tile->cell[y];
+        float acc = 0.0F;
+        for (x = 0; x < tile->width; ++x) {
+            float cover;
+            acc += cell[x];
+            cell[x] = 0.0F;
+            cover = pxAbs(acc);
+            if (rule == SPXP_FILL_EVENODD) {
+                cover -= 2.0F * (float)floor(cover * 0.5F);
+                cover = cover > 1.0F ? 2.0F - cover : cover;
+            }
+            mask[x] = (uint8_t)(pxMin(cover, 1.0F) * 255.0F + 0.5F);
         }
- 
-        startx = pxMax(x0, 0);
-        endx = pxMin(x1 + 1, fb.width);
+        cell[tile->width] = cell[tile->width + 1] = 0.0F;
         
-        for (x = startx; x < endx; ++x) {
+        pxBlendMask(&pxAt(texture, tile->x, tile->y + y), mask, (size_t)tile->width, color);
+    }
+}
+
+void pxPlotPath(
+    const Tex2D texture, const vec2* p, const int* counts, int n, int rule, const Px color)
+{
+    int i, j, first, total = 0, startx, starty, endx, endy;
+    vec2 lo, hi;
+    pxFillTile tile;
+
+    for (i = 0; i < n; ++i) {
+        total += counts[i];
+    }
+    if (total < 3) {
+        return;
+    }
+
+    lo = hi = p[0];
+    for (i = 1; i < total; ++i) {
+        lo.x = pxMin(lo.x, p[i].x);
+        lo.y = pxMin(lo.y, p[i].y);
+        hi.x = pxMax(hi.x, p[i].x);
+        hi.y = pxMax(hi.y, p[i].y);
+    }
+    
+    pxDirtyHull(texture, p, total);
+    startx = (int)floor(pxMax(lo.x + 0.5F, 0.0F));
+    starty = (int)floor(pxMax(lo.y + 0.5F, 0.0F));
+    endx = (int)ceil(pxMin(hi.x + 0.5F, (float)texture.width)) - 1;
+    endy = (int)ceil(pxMin(hi.y + 0.5F, (float)texture.height)) - 1;
+
+    /* later tiles are never larger, the resolve clears what it reads */
+    for (i = 0; i < pxMin(endy - starty + 1, SPXP_FILL_ROWS); ++i) {
+        for (j = 0; j < pxMin(endx - startx + 1, SPXP_SPAN_MAX) + 2; ++j) {
+            tile.cell[i][j] = 0.0F;
+        }
+    }
+
+    for (tile.y = starty; tile.y <= endy; tile.y += SPXP_FILL_ROWS) {
+        tile.height = pxMin(endy - tile.y + 1, SPXP_FILL_ROWS);
+        for (tile.x = startx; tile.x <= endx; tile.x += SPXP_SPAN_MAX) {
             
-            Px color;
-            vec2 p, uv;
-            unsigned int j;
-            float t, sum = 0.0F;
+            const float ox = (float)tile.x - 0.5F, oy = (float)tile.y - 0.5F;
+            tile.width = pxMin(endx - tile.x + 1, SPXP_SPAN_MAX);
             
-            t = normalize(x0, x1, x),
-            uv = vec2_mix(uv0, uv1, t);
-            p.x = (float)x;
-            p.y = (float)y;
-
-            for (j = 0; j < sizeof(P) / sizeof(p); ++j) {
-                vec2 q;
-                q.x = p.x + 0.5F * P[j].x;
-                q.y = p.y + 0.5F * P[j].y;
-                sum += (float)( vec2_determinant(p1.pos, p2.pos, q) >= 0.0F &&
-                                vec2_determinant(p2.pos, p0.pos, q) >= 0.0F &&
-                                vec2_determinant(p0.pos, p1.pos, q) >= 0.0F);
+            for (i = 0, first = 0; i < n; first += counts[i++]) {
+                for (j = 0; j < counts[i]; ++j) {
+                    vec2 a = p[first + j], b = p[first + (j + 1) % counts[i]];
+                    a.x -= ox;
+                    a.y -= oy;
+                    b.x -= ox;
+                    b.y -= oy;
+                    if (pxMax(a.y, b.y) > 0.0F && pxMin(a.y, b.y) < (float)tile.height) {
+                        pxFillEdge(&tile, a, b);
+                    }
+                }
             }
-           
-            color = pxTexMapBilinear(texture, uv);
-            pxBlend(fb, x, y, sum * ni, color);
 
+            pxFillResolve(texture, &tile, rule, color);
         }
     }
 }
 
+void pxPlotPolygon(const Tex2D texture, const vec2* p, int count, int rule, const Px color)
+{
+    pxPlotPath(texture, p, &count, 1, rule, color);
+}
+
 void pxPlotTexture(const Tex2D fb, const Tex2D texture, ivec2 p)
 {
     int x, y;
@@ -689,6 +1917,7 @@ void pxPlotTexture(const Tex2D fb, const Tex2D texture, ivec2 p)
     const int endx = pxClamp(p.x + texture.width - 1, 0, resx);
     const int endy = pxClamp(p.y + texture.height - 1, 0, resy);
     coord.y = -pxMin(0, p.y);
+    pxDirtyBounds(fb, startx, starty, endx - 1, endy - 1);
     for (y = starty; y < endy; ++y, ++coord.y) {
         coord.x = minx;
         for (x = startx; x < endx; ++x, ++coord.x) {
@@ -704,59 +1933,236 @@ void pxPlotTextureCentered(const Tex2D fb, const Tex2D texture, ivec2 p)
     pxPlotTexture(fb, texture, p);
 }
 
+static int pxCircleInside(const ivec2 p, const int x, const float dy, const float sqr)
+{
+    const float dx = p.x - x + 0.5F;
+    return dx * dx + dy <= sqr;
+}
+
 void pxPlotCircle(const Tex2D texture, ivec2 p, float r, const Px color)
 {
-    int x, y;
+    int y;
     const float sqr = r * r;
     const int resx = texture.width - 1, resy = texture.height - 1;
     const int startx = pxClamp(p.x - r, 0, resx);
     const int starty = pxClamp(p.y - r, 0, resy);
     const int endx = pxClamp(p.x + r + 1.0F, 0, resx);
     const int endy = pxClamp(p.y + r + 1.0F, 0, resy);
+    pxDirtyBounds(texture, startx, starty, endx, endy);
     for (y = starty; y <= endy; ++y) {
-        float dy = p.y - y + 0.5F;
+        int x0, x1;
+        float h, dy = p.y - y + 0.5F;
         dy *= dy;
-        for (x = startx; x <= endx; ++x) {
-            float dx = p.x - x + 0.5F;
-            if (dx * dx + dy <= sqr) {
-                pxAt(texture, x, y) = color;
-            }
+        if (dy > sqr) {
+            continue;
+        }
+        
+        /* the row is a single span, estimate its ends and settle rounding */
+        h = sqrt(sqr - dy);
+        x0 = pxMax((int)ceil(p.x + 0.5F - h), startx);
+        x1 = pxMin((int)floor(p.x + 0.5F + h), endx);
+        while (x0 <= x1 && !pxCircleInside(p, x0, dy, sqr)) {
+            ++x0;
+        }
+        while (x0 > startx && pxCircleInside(p, x0 - 1, dy, sqr)) {
+            --x0;
+        }
+        while (x1 >= x0 && !pxCircleInside(p, x1, dy, sqr)) {
+            --x1;
+        }
+        while (x1 < endx && pxCircleInside(p, x1 + 1, dy, sqr)) {
+            ++x1;
+        }
+
+        if (x0 <= x1) {
+            pxFillSpan(&pxAt(texture, x0, y), (size_t)(x1 - x0 + 1), color);
         }
     }
 }
 
-void pxPlotCircleSmooth(const Tex2D texture, ivec2 p, float r, const Px color)
+/* ellipses and rings by rows, centered between pixels like pxPlotCircle */
+
+static float pxEllipseHalf(const vec2 r, const float dy)
 {
-    int x, y, sx, sy;
-    const float sqr = r * r;
-    static const float subscale = 1.0F / (float)SPXP_SUBSAMPLES;
+    const float v = dy / r.y;
+    return r.x > 0.0F && r.y > 0.0F && v * v <= 1.0F ? r.x * sqrt(1.0F - v * v) : -1.0F;
+}
+
+/* area of a pixel covered, from the approximate distance to the boundary */
+
+static float pxEllipseCoverage(const vec2 r, const float dx, const float dy)
+{
+    float u, v, f, g, d;
+    if (r.x <= 0.0F || r.y <= 0.0F) {
+        return 0.0F;
+    }
+
+    u = dx / r.x;
+    v = dy / r.y;
+    f = sqrt(u * u + v * v);
+    g = sqrt((u / r.x) * (u / r.x) + (v / r.y) * (v / r.y));
+    if (g == 0.0F) {
+        return 1.0F;
+    }
+
+    d = (f - 1.0F) * f / g;
+    return pxClamp(0.5F - d, 0.0F, 1.0F);
+}
+
+/* pixels of a row touching or fully inside an ellipse, empty when start > end */
+
+static void pxEllipseRow(
+    const vec2 r, const float cx, const float dy, 
+    int* touch0, int* touch1, int* full0, int* full1)
+{
+    const float top = dy - 0.5F, bottom = dy + 0.5F;
+    const float mid = top > 0.0F ? top : bottom < 0.0F ? bottom : 0.0F;
+    const float hmax = pxEllipseHalf(r, mid);
+    const float hmin = pxMin(pxEllipseHalf(r, top), pxEllipseHalf(r, bottom));
+
+    *touch0 = 1;
+    *touch1 = 0;
+    *full0 = 1;
+    *full1 = 0;
+    if (hmax >= 0.0F) {
+        *touch0 = (int)floor(cx - hmax - 0.5F) + 1;
+        *touch1 = (int)ceil(cx + hmax + 0.5F) - 1;
+    }
+    if (hmin >= 0.0F) {
+        *full0 = (int)ceil(cx - hmin + 0.5F);
+        *full1 = (int)floor(cx + hmin - 0.5F);
+    }
+}
+
+static void pxFillEllipse(const Tex2D texture, ivec2 p, vec2 r, vec2 hole, const Px color)
+{
+    int y;
+    const float cx = (float)p.x + 0.5F, cy = (float)p.y + 0.5F;
     const int resx = texture.width - 1, resy = texture.height - 1;
-    const int startx = pxClamp(p.x - r - 1.0F, 0, resx);
-    const int starty = pxClamp(p.y - r - 1.0F, 0, resy);
-    const int endx = pxClamp(p.x + r + 1.0F, 0, resx);
-    const int endy = pxClamp(p.y + r + 1.0F, 0, resy);
+    const int starty = pxClamp((int)ceil(cy - r.y), 0, resy);
+    const int endy = pxClamp((int)floor(cy + r.y), 0, resy);
+    pxDirtyBounds(
+        texture, (int)floor(cx - r.x), starty, (int)ceil(cx + r.x), endy
+    );
+    
     for (y = starty; y <= endy; ++y) {
-        const float dy = p.y - (float)y + 0.5F;
-        for (x = startx; x <= endx; ++x) {
+        
+        int x0, x1, h0, h1;
+        const float dy = (float)y - cy;
+        const float h = pxEllipseHalf(r, dy), inner = pxEllipseHalf(hole, dy);
+        if (h < 0.0F) {
+            continue;
+        }
+
+        /* pixel centers inside the ellipse and strictly outside the hole */
+        x0 = pxMax((int)ceil(cx - h), 0);
+        x1 = pxMin((int)floor(cx + h), resx);
+        h0 = inner > 0.0F ? (int)floor(cx - inner) + 1 : x1 + 1;
+        h1 = inner > 0.0F ? (int)ceil(cx + inner) - 1 : x1;
+        
+        if (x0 <= pxMin(x1, h0 - 1)) {
+            pxFillSpan(&pxAt(texture, x0, y), (size_t)(pxMin(x1, h0 - 1) - x0 + 1), color);
+        }
+        if (pxMax(x0, h1 + 1) <= x1) {
+            x0 = pxMax(x0, h1 + 1);
+            pxFillSpan(&pxAt(texture, x0, y), (size_t)(x1 - x0 + 1), color);
+        }
+    }
+}
+
+static void pxFillEllipseSmooth(const Tex2D texture, ivec2 p, vec2 r, vec2 hole, const Px color)
+{
+    int y;
+    uint8_t mask[SPXP_SPAN_MAX];
+    const float cx = (float)p.x + 0.5F, cy = (float)p.y + 0.5F;
+    const int resx = texture.width - 1, resy = texture.height - 1;
+    const int starty = pxClamp((int)floor(cy - r.y - 0.5F), 0, resy);
+    const int endy = pxClamp((int)ceil(cy + r.y + 0.5F), 0, resy);
+    pxDirtyBounds(
+        texture, (int)floor(cx - r.x - 1.0F), starty, (int)ceil(cx + r.x + 1.0F), endy
+    );
+    
+    for (y = starty; y <= endy; ++y) {
+        
+        int x, endx, t0, t1, f0, f1, h0, h1, k0, k1;
+        const float dy = (float)y - cy;
+        
+        /* solid pixels are filled, only the ones across a boundary get coverage */
+        pxEllipseRow(r, cx, dy, &t0, &t1, &f0, &f1);
+        pxEllipseRow(hole, cx, dy, &h0, &h1, &k0, &k1);
+        if (h0 > h1) {
+            h0 = t1 + 1;
+            h1 = t0 - 1;
+        }
+
+        x = pxMax(t0, 0);
+        endx = pxMin(t1, resx);
+        while (x <= endx) {
             
-            int count = 0;
-            float dx = p.x - (float)x + 0.5F, n;
+            int n = 0;
+            if (x >= k0 && x <= k1) {
+                x = k1 + 1;
+                continue;
+            }
             
-            for (sy = 0; sy < SPXP_SUBSAMPLES; ++sy) {
-                float sdy = dy + (float)sy * subscale;
-                sdy *= sdy;
-                for (sx = 0; sx < SPXP_SUBSAMPLES; ++sx) {
-                    float sdx = dx + (float)sx * subscale;
-                    count += (sdx * sdx + sdy) <= sqr;
-                }
+            if (x >= f0 && x <= f1 && (x < h0 || x > h1)) {
+                const int end = pxMin(x < h0 ? pxMin(f1, h0 - 1) : f1, endx);
+                pxFillSpan(&pxAt(texture, x, y), (size_t)(end - x + 1), color);
+                x = end + 1;
+                continue;
             }
+
+            do {
+                const float dx = (float)x - cx;
+                const float c = pxEllipseCoverage(r, dx, dy) - pxEllipseCoverage(hole, dx, dy);
+                mask[n++] = (uint8_t)(pxMax(c, 0.0F) * 255.0F + 0.5F);
+                ++x;
+            } while (   x <= endx && n < SPXP_SPAN_MAX && (x < k0 || x > k1) && 
+                        (x < f0 || x > f1 || (x >= h0 && x <= h1)));
             
-            n = (float)count / (float)(SPXP_SUBSAMPLES * SPXP_SUBSAMPLES);
-            pxBlend(texture, x, y, n, color);
+            pxBlendMask(&pxAt(texture, x - n, y), mask, (size_t)n, color);
         }
     }
 }
 
+void pxPlotCircleSmooth(const Tex2D texture, ivec2 p, float r, const Px color)
+{
+    vec2 radius, hole;
+    radius.x = radius.y = r;
+    hole.x = hole.y = 0.0F;
+    pxFillEllipseSmooth(texture, p, radius, hole, color);
+}
+
+void pxPlotEllipse(const Tex2D texture, ivec2 p, vec2 r, const Px color)
+{
+    vec2 hole;
+    hole.x = hole.y = 0.0F;
+    pxFillEllipse(texture, p, r, hole, color);
+}
+
+void pxPlotEllipseSmooth(const Tex2D texture, ivec2 p, vec2 r, const Px color)
+{
+    vec2 hole;
+    hole.x = hole.y = 0.0F;
+    pxFillEllipseSmooth(texture, p, r, hole, color);
+}
+
+void pxPlotRing(const Tex2D texture, ivec2 p, float r0, float r1, const Px color)
+{
+    vec2 radius, hole;
+    radius.x = radius.y = r1;
+    hole.x = hole.y = r0;
+    pxFillEllipse(texture, p, radius, hole, color);
+}
+
+void pxPlotRingSmooth(const Tex2D texture, ivec2 p, float r0, float r1, const Px color)
+{
+    vec2 radius, hole;
+    radius.x = radius.y = r1;
+    hole.x = hole.y = r0;
+    pxFillEllipseSmooth(texture, p, radius, hole, color);
+}
+
 #endif /* SPXP_APPLICATION */
 #endif /* SIMPLE_PIXEL_PLOTTER_H */
 